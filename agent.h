@@ -12,21 +12,29 @@
 #include <random>
 #include <sstream>
 #include <map>
+#include <unordered_map>
 #include <type_traits>
 #include <algorithm>
 #include <chrono>
 #include "board.h"
 #include "action.h"
 #include <fstream>
-#include <set>
-
-
-struct empty_pos
-{
-	/* data */
-	board::point pos;
-	bool use = false;
-};
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <iomanip>
+#include <cmath>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include <iostream>
+#include "playout.h"
+#include "solver.h"
 
 class agent {
 public:
@@ -44,6 +52,21 @@ public:
 	virtual action take_action(const board& b) { return action(); }
 	virtual bool check_for_win(const board& b) { return false; }
 
+	/**
+	 * the clock of the game, e.g., set by the GTP time commands:
+	 * main time and byo-yomi of byo_yomi_time seconds per byo_yomi_stones moves, and the
+	 * time left of the current period, where stones > 0 tells the moves left in byo-yomi
+	 */
+	virtual void set_time(double main_time, double byo_yomi_time, int byo_yomi_stones) {}
+	virtual void set_time_left(double time, int stones) {}
+
+	/**
+	 * search in the background from b, with this agent to move, and report the search every
+	 * interval seconds until end_analysis() is called
+	 */
+	virtual void analyze(const board& b, double interval, const std::function<void(const std::string&)>& report) {}
+	virtual void end_analysis() {}
+
 public:
 	virtual std::string property(const std::string& key) const { return meta.at(key); }
 	virtual void notify(const std::string& msg) { meta[msg.substr(0, msg.find('='))] = { msg.substr(msg.find('=') + 1) }; }
@@ -76,6 +99,19 @@ public:
 	}
 	virtual ~random_agent() {}
 
+protected:
+	/**
+	 * pick a legal move of who uniformly at random from the legal moves of the board
+	 * return action() if it is not the turn of who, or there is no legal move
+	 */
+	action random_move(const board& state, board::piece_type who) {
+		board::bitboard moves = state.legal_moves(who);
+		if (state.info().who_take_turns != who || !moves) return action();
+		std::uniform_int_distribution<unsigned> pick(0, moves.count() - 1);
+		for (unsigned k = pick(engine); k; k--) moves.pop();
+		return action::place(board::at(moves.lsb()), who);
+	}
+
 protected:
 	std::default_random_engine engine;
 };
@@ -87,233 +123,561 @@ protected:
 class player : public random_agent {
 public:
 	player(const std::string& args = "") : random_agent("name=random role=unknown " + args),
-		space(board::size_x * board::size_y), who(board::empty) {
+		who(board::empty) {
 		if (name().find_first_of("[]():; ") != std::string::npos)
 			throw std::invalid_argument("invalid name: " + name());
 		if (role() == "black") who = board::black;
 		if (role() == "white") who = board::white;
 		if (who == board::empty)
 			throw std::invalid_argument("invalid role: " + role());
-		for (size_t i = 0; i < space.size(); i++)
-			space[i] = action::place(i, who);
 	}
 
 	virtual action take_action(const board& state) {
-		std::shuffle(space.begin(), space.end(), engine);
-		
-		for (const action::place& move : space) {
-			board after = state;
-			int tmp = move.position().i;
-			if (move.apply(after) == board::legal)
-				return move;
-		}
-		return action();
+		return random_move(state, who);
 	}
 
 private:
-	std::vector<action::place> space;
 	board::piece_type who;
 };
 
-class Node {
+/**
+ * search tree of MCTS, stored as a structure of arrays in slabs of (1 << slab_bits) nodes
+ * a node is addressed by a 32-bit index and described by the entries at that index of
+ * the arrays, which take 23 bytes per node
+ *
+ * the children of a node are a run of adjacent nodes that never crosses a slab, so the
+ * statistics of the children are adjacent in each array and are scored in one pass by
+ * select_child(), which is vectorized with AVX2 or SSE2 if enabled at compile time
+ *
+ * the slabs are kept by reset(), which drops the whole tree in O(1), hence the system
+ * allocator is only used when the tree grows beyond its largest size so far; between the
+ * moves, the subtree that is kept is moved to the front of the pool by compact()
+ *
+ * the statistics of a node are counted for the player who made the move leading to it
+ *
+ * the tree can be shared by several search threads: the counters are updated by relaxed
+ * atomic additions and read without locking, a node is expanded only by the thread that
+ * claims it, and its children are published by the release store of their count
+ *
+ * optionally, the nodes at the same position share their children through a transposition
+ * table, which turns the tree into a DAG; a node keeps its own statistics, i.e., those of
+ * the move leading to it, while the statistics below it are shared, see share()
+ *
+ * also optionally, the children are widened progressively in the order of their priors, see widen()
+ *
+ * the nodes whose results are certain are proven by the backups, see solve(), and a proven node
+ * is neither searched below nor played out, while a proven loss is never selected
+ */
+class tree {
 public:
-	const void init_root() noexcept {
-		root_ = true;
-		parent_ = nullptr;
-	}
-
-	const void init_bw(board::piece_type bw) noexcept {
-		bw_ = bw;
-	}
-	const bool is_root_or_not() noexcept { return root_;}
-   	constexpr Node *get_parent() const noexcept { return parent_; };
-   	constexpr bool has_children() const noexcept { return children_size_ > 0; }
-	int select_child(board::piece_type &bw, board::point &pos) {
-   		float max_score = -10000.f;
-		int max_i = -1;
-   		for (size_t i = 0; i < children_size_; ++i) {
-			//&很重要，不然就要用children_[i]
-       		auto &child = children_[i];
-       		const float score = (child.rave_wins_ + child.wins_ +
-                        std::sqrt(log_visits_ * child.visits_) * 0.25f) /
-                        (child.rave_visits_ + child.visits_);
-       		child.uct_score_ = score;
-       		//max_score = (score - max_score > 0.0001f) ? score : max_score;
-			if(score - max_score > 0.0001f){
-				max_score = score;
-				max_i = i;
-				bw = child.bw_;
-				//pos = child.pos_;
-				pos = board::point(child.pos_);
-			}
-   		}
-   		return max_i;
-   	}
-
-	bool expand(const board &b,std::vector<empty_pos> emp_pos_vec, int emp_pos_count) noexcept {
-		if(visits_ == 0 || is_leaf_) return false;
-
-		board::piece_type child_bw;
-		child_bw = (bw_ == board::black)?board::white:board::black;
-		// make_unique is invalid in C++ 11, and tcglinux is C++ 11, not C++ 14!!!
-		//children_ = std::make_unique<Node[]>(emp_pos_count);
-		children_ = new Node[emp_pos_count];
-		//for (const action::place& move : space) {
-		for (const empty_pos &move : emp_pos_vec) {
-			//if(b[move.position().x][move.position().y] != 0){
-			//	continue;
-			//}
-			if(move.pos.x == -1 && move.pos.y == -1){
-				printf("WTF is this\n");
+	typedef uint32_t index;
+	enum : index { none = -1u };
+	enum { slab_bits = 16, slab_size = 1u << slab_bits, max_slabs = 1u << 12 };
+	enum { rave_wins_init = 10, rave_visits_init = 20 };
+	enum { prior_wins = 5, widen_base = 5, widen_visits = 40 };
+
+	tree() : slabs(), used(0), exhausted(false), generation(1) {}
+	tree(const tree&) = delete;
+	tree& operator =(const tree&) = delete;
+	~tree() { for (auto& s : slabs) delete s.load(); }
+
+	/**
+	 * allocate n adjacent fresh nodes, where n <= slab_size, and return the index of the first one,
+	 * or none if the pool of max_slabs slabs is used up, after which full() returns true
+	 * this is safe to call from several threads, which only lock to add a slab
+	 */
+	index allocate(unsigned n) {
+		index first, last = used.load(std::memory_order_relaxed);
+		do {
+			first = ((last % slab_size) + n > slab_size) ? (last / slab_size + 1) * slab_size : last;
+			if (first / slab_size >= max_slabs) {
+				exhausted.store(true, std::memory_order_relaxed);
+				return none;
 			}
-			if(move.use == true) continue;
-			board after = b;
-			if(after.place(move.pos, child_bw) == board::legal){
-				//printf("tmp_pos: %d,%d,%d\n", move.pos.x, move.pos.y, move.pos.i);
-				children_[children_size_].init(child_bw, move.pos, this);
-				children_size_ ++;
+		} while (!used.compare_exchange_weak(last, first + n, std::memory_order_relaxed));
+		if (!slabs[first / slab_size].load(std::memory_order_acquire)) grow(first / slab_size);
+		slab& s = of(first);
+		unsigned k = first % slab_size;
+		std::fill_n(s.visits + k, n, 0);
+		std::fill_n(s.wins + k, n, 0);
+		std::fill_n(s.rave_visits + k, n, uint32_t(rave_visits_init));
+		std::fill_n(s.rave_wins + k, n, uint32_t(rave_wins_init));
+		std::fill_n(s.children + k, n, index(none));
+		std::fill_n(s.size + k, n, 0);
+		std::fill_n(s.flags + k, n, 0);
+		return first;
+	}
+	void reset() { used = 0; exhausted = false; generation++; }
+
+	/**
+	 * keep only the nodes reachable from root, and return the new index of root
+	 * the nodes are copied into the pool of spare, whose slabs are then swapped with the slabs
+	 * of this tree, so the abandoned nodes are reclaimed; the children shared by the nodes at
+	 * the same position stay shared, but the transposition table is cleared
+	 * no search should be running on either tree
+	 */
+	index compact(index root, tree& spare) {
+		spare.reset();
+		std::unordered_map<index, index> runs; // the copies of the runs of children, by their first nodes
+		std::vector<std::pair<index, index>> todo; // the copied nodes whose children are to be copied
+		const index top = spare.allocate(1);
+		spare.copy(top, *this, root);
+		todo.emplace_back(root, top);
+		while (!todo.empty()) {
+			const index from = todo.back().first, to = todo.back().second;
+			todo.pop_back();
+			const unsigned n = children_size(from);
+			if (!n) continue;
+			const index first = of(from).children[from % slab_size];
+			auto run = runs.find(first);
+			if (run == runs.end()) {
+				const index copied = spare.allocate(n);
+				if (copied == none) { // not expected, since the copy is no larger than the tree
+					spare.of(to).size[to % slab_size] = 0;
+					spare.of(to).flags[to % slab_size] &= ~uint8_t(claimed);
+					continue;
+				}
+				for (unsigned k = 0; k < n; k++) {
+					spare.copy(copied + k, *this, first + k);
+					todo.emplace_back(first + k, copied + k);
+				}
+				run = runs.emplace(first, copied).first;
 			}
-			//if (move.apply(after) == board::legal){
-			//	children_[children_size_].init(child_bw, move.position(), this);
-			//	children_size_ ++;
-			//}
+			spare.of(to).children[to % slab_size] = run->second;
 		}
-		if(children_size_ == 0){
-			is_leaf_ = true;
-			return false;
+		for (unsigned k = 0; k < max_slabs; k++) {
+			slab* mine = slabs[k].load(std::memory_order_relaxed);
+			slabs[k].store(spare.slabs[k].load(std::memory_order_relaxed), std::memory_order_relaxed);
+			spare.slabs[k].store(mine, std::memory_order_relaxed);
 		}
+		used.store(spare.used.load());
+		exhausted = spare.exhausted.load();
+		generation++;
+		spare.reset();
+		return top;
+	}
+	size_t size() const { return used; }
+	bool full() const { return exhausted.load(std::memory_order_relaxed); }
 
-   		return true;
-   	}
-	void update(size_t winner,
-            const std::set<int> &bpos, const std::set<int> &wpos) noexcept {
-   		++visits_;
-   		log_visits_ = std::log(visits_);
+	/**
+	 * share the children of the nodes at the same position through a transposition table of
+	 * (1 << bits) entries, or stop sharing if bits = 0
+	 * the table is in buckets of two entries, and a node expanded at a new position replaces
+	 * the entry whose node has fewer visits, so the table keeps the most searched positions
+	 */
+	void share(unsigned bits) {
+		table.reset(bits ? new entry[1ull << bits] : nullptr);
+		mask = bits ? (1ull << bits) - 2 : 0;
+		generation++;
+	}
+
+	/**
+	 * widen the children progressively: the children are ordered by the mobility gain of their
+	 * moves (see board::mobility), which also gives them up to prior_wins RAVE wins more or less
+	 * than the others, and a node of N visits selects among its first
+	 *   widen_base + log(1 + N / widen_visits) / log(1.4)
+	 * children only, so a child is unlocked each time the visits grow by a factor of about 1.4
+	 */
+	void widen(bool on) { widening = on; }
 
-        size_t cwin;
-		std::set<int> tmp_pos;
-		if (static_cast<size_t>(winner == bw_)){
-			//一般的monte carlo tree search
-			wins_ += 1;
-			cwin = 0;
+protected:
+	void grow(unsigned k) {
+		std::lock_guard<std::mutex> lock(growing);
+		if (!slabs[k].load(std::memory_order_relaxed)) slabs[k].store(new slab, std::memory_order_release);
+	}
+
+public:
+	/**
+	 * the board bit (see board::bit) of the move leading to node i
+	 */
+	unsigned move(index i) const { return of(i).move[i % slab_size]; }
+	unsigned visits(index i) const { return __atomic_load_n(&of(i).visits[i % slab_size], __ATOMIC_RELAXED); }
+	unsigned wins(index i) const { return __atomic_load_n(&of(i).wins[i % slab_size], __ATOMIC_RELAXED); }
+	bool is_leaf(index i) const { return __atomic_load_n(&of(i).flags[i % slab_size], __ATOMIC_ACQUIRE) & leaf; }
+	bool is_won(index i) const { return __atomic_load_n(&of(i).flags[i % slab_size], __ATOMIC_ACQUIRE) & won; }
+	bool is_lost(index i) const { return __atomic_load_n(&of(i).flags[i % slab_size], __ATOMIC_ACQUIRE) & lost; }
+	bool is_solved(index i) const { return __atomic_load_n(&of(i).flags[i % slab_size], __ATOMIC_ACQUIRE) & (won | lost); }
+	bool has_children(index i) const { return __atomic_load_n(&of(i).size[i % slab_size], __ATOMIC_ACQUIRE); }
+	unsigned children_size(index i) const { return __atomic_load_n(&of(i).size[i % slab_size], __ATOMIC_ACQUIRE); }
+	index child(index i, unsigned k) const { return of(i).children[i % slab_size] + k; }
+
+	/**
+	 * expand node i at board b with the legal moves of who, the player to move at node i
+	 * a node is expanded on its second visit, where a visit is a batch of playouts, and a node
+	 * without legal move becomes a leaf, which is a proven win for the player who moved into it
+	 * only one thread claims the node, the others return false and play out from it, and if the
+	 * pool is full, the node is released unexpanded and false is returned as well
+	 */
+	bool expand(index i, const board& b, board::piece_type who, unsigned batch = 1) {
+		slab& s = of(i);
+		unsigned k = i % slab_size;
+		uint8_t fresh = 0;
+		if (visits(i) <= batch || !__atomic_compare_exchange_n(&s.flags[k], &fresh, uint8_t(claimed),
+				false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) return false;
+		index same = table ? find(b.hash()) : index(none);
+		unsigned n = same != none ? children_size(same) : 0;
+		if (n) { // link to the children of the same position
+			s.children[k] = of(same).children[same % slab_size];
+			__atomic_store_n(&s.size[k], uint8_t(n), __ATOMIC_RELEASE);
+			return true;
 		}
-		else{
-			cwin = 1;
+		board::bitboard moves = b.legal_moves(who);
+		if (!moves) {
+			__atomic_store_n(&s.flags[k], uint8_t(claimed | leaf | won), __ATOMIC_RELEASE);
+			return false;
 		}
-		//child的bw_是另一方的
-		if(bw_ == board::black){
-			tmp_pos = wpos;
+		n = moves.count();
+		index first = allocate(n);
+		if (first == none) {
+			__atomic_store_n(&s.flags[k], uint8_t(0), __ATOMIC_RELEASE);
+			return false;
 		}
-		else{
-			tmp_pos = bpos;
-		}
-
-		//rave
-		//printf("children_size_ : %d\n", children_size_);
-   		for (size_t i = 0; i < children_size_; ++i) {
-       		auto &child = children_[i];
-			std::set<int>::iterator it;
-			//printf("child_pos_i: %d\n", child.pos_.i);
-			it = std::find(tmp_pos.begin(), tmp_pos.end(), child.pos_.i);
-			if(it != tmp_pos.end()){
-				++child.rave_visits_;
-       			child.rave_wins_ += cwin;
-			}
-			/*
-			if(std::find(tmp_pos.begin(), tmp_pos.end(), child.pos_.i) != tmp_pos.end()){
-				++child.rave_visits_;
-       			child.rave_wins_ += cwin;
+		slab& c = of(first);
+		if (widening) prioritize(c, first % slab_size, moves, b, who);
+		else for (unsigned j = first % slab_size; moves; j++) c.move[j] = moves.pop();
+		s.children[k] = first;
+		__atomic_store_n(&s.size[k], uint8_t(n), __ATOMIC_RELEASE);
+		if (table) store(b.hash(), i);
+		return true;
+	}
+
+	/**
+	 * select the child of node i with the highest score
+	 *   (rave_wins + wins + 0.25 * sqrt(log(N) * visits)) / (rave_visits + visits)
+	 * where N is the visit count of node i, ties are broken by the order of the children
+	 * only the unlocked children are scored if the children are widened, see widen(), and the
+	 * proven losses are skipped unless all the children are
+	 */
+	index select_child(index i) const {
+		// the size is loaded first, whose release by expand() publishes the children
+		const unsigned size = children_size(i), total = visits(i);
+		index first = of(i).children[i % slab_size];
+		const slab& c = of(first);
+		unsigned j = first % slab_size, n = size;
+		if (widening) n = std::min(n, unsigned(widen_base + std::log(1.f + float(total) / widen_visits) * 2.972f));
+		const float log_n = std::log(float(total));
+		unsigned best = score(c.visits + j, c.wins + j, c.rave_visits + j, c.rave_wins + j, c.flags + j, n, log_n);
+		if (best == n && n < size) // the unlocked children are all lost, so the locked ones are tried
+			best = score(c.visits + j, c.wins + j, c.rave_visits + j, c.rave_wins + j, c.flags + j, size, log_n);
+		return first + (best < size ? best : 0);
+	}
+
+	/**
+	 * count n playouts through node i on the way down, which act as a virtual loss until update()
+	 */
+	void visit(index i, unsigned n = 1) {
+		__atomic_fetch_add(&of(i).visits[i % slab_size], n, __ATOMIC_RELAXED);
+	}
+
+	/**
+	 * back up n playouts through node i, where won of them are won by the player who moved
+	 * into node i, and amaf holds the points played in the playouts by the player to move
+	 * at node i, which update the RAVE statistics of the children
+	 */
+	void update(index i, unsigned won, unsigned n, const board::bitboard& amaf) {
+		slab& s = of(i);
+		unsigned k = i % slab_size;
+		if (won) __atomic_fetch_add(&s.wins[k], won, __ATOMIC_RELAXED);
+		unsigned size = children_size(i);
+		if (!size) return;
+		slab& c = of(s.children[k]);
+		unsigned first = s.children[k] % slab_size, last = first + size;
+		for (unsigned j = first; j < last; j++) {
+			if (amaf.test(c.move[j])) {
+				__atomic_fetch_add(&c.rave_visits[j], n, __ATOMIC_RELAXED);
+				if (won < n) __atomic_fetch_add(&c.rave_wins[j], n - won, __ATOMIC_RELAXED);
 			}
-			*/
-   		}
-   	}
-/*
-   	void get_children_visits(std::unordered_map<board::point, size_t> &visits) const
-       	noexcept {
-   		for (size_t i = 0; i < children_size_; ++i) {
-       		const auto &child = children_[i];
-       		if (child.visits_ > 0) {
-       			visits.emplace(child.pos_, child.visits_);
-       		}
-   		}
-   	}
-*/
-
-	int get_best_move(){
-		//int max_i = -1;
-		int max_i = 0;
-		int max_visits = 0;
-		int max_wins = 0;
-		board::point best_move;
-		
-		for (size_t i = 0; i < children_size_; ++i) {
-       		const auto &child = children_[i];
-			if(child.pos_.x == -1 && child.pos_.y == -1){
-				printf("WTF is this\n");
+		}
+	}
+
+	/**
+	 * prove node i by its children after a backup, and return whether it is proven: for the player
+	 * who moved into node i, it is a loss if any child is a win for the opponent, and a win if all
+	 * the children are losses for the opponent, where a leaf is proven by expand()
+	 * a node changes only if a child does, so a backup proves the nodes upward until one is unproven
+	 */
+	bool solve(index i) {
+		slab& s = of(i);
+		unsigned k = i % slab_size;
+		if (is_solved(i)) return true;
+		unsigned size = children_size(i);
+		if (!size) return false;
+		const slab& c = of(s.children[k]);
+		unsigned first = s.children[k] % slab_size, last = first + size;
+		bool all_lost = true;
+		for (unsigned j = first; j < last; j++) {
+			uint8_t f = __atomic_load_n(&c.flags[j], __ATOMIC_ACQUIRE);
+			if (f & won) {
+				__atomic_fetch_or(&s.flags[k], uint8_t(lost), __ATOMIC_RELEASE);
+				return true;
 			}
-			if (child.visits_ == 0) continue;
-			if(child.valid_ == false) continue;
-       		if (child.visits_ >= max_visits) {
-       			if(child.wins_ > max_wins) 
-				   //printf("what is this: %d, %d\n", child.pos_.x, child.pos_.y);
-				   max_visits = child.visits_;
-				   max_wins = child.wins_;
-				   max_i = i;
-				   //best_move.x = child.pos_.x;
-				   //best_move.y = child.pos_.y;
-				   //best_move.i = best_move.x + best_move.y*9;
-				   //best_move.i = child.pos_.i;
-				   best_move = board::point(child.pos_);
-       		}
-   		}
-
-		//return &children_[max_i];
-		return max_i;
-		/*
-		//const auto &child = children_[max_i];
-		//return children_[max_i].pos_;
-		if(best_move.x == -1 && best_move.y == -1){
-				printf("WTF is this\n");
-				printf("child_size : %d, max_i: %d\n", children_size_, max_i);
-		}
-		return best_move;
-		*/
-	}
-// private:
-	inline const void init(board::piece_type who, board::point pos, Node *parent) noexcept {
-		bw_ = who;
-		pos_ = pos;
-		//pos_.x = pos.x;
-		//pos_.y = pos.y;
-		//pos_.i = pos.i;
-		pos_ = board::point(pos);
-   		parent_ = parent;
-		valid_ = true;
-		/*
-		children_size_ = 0;
-		wins_ = 0;
-		visits_ = 0;
-		rave_wins_ = 10;
-		rave_visits_ = 20;
-		log_visits_ = 0.f;
-		*/
-   	}
-   	size_t children_size_ = 0;
-	// make_unique is invalid in C++ 11, and tcglinux is C++ 11, not C++ 14!!!
-	// So use *children_ instead!!!
-   	//std::unique_ptr<Node[]> children_;
-	Node *children_;
-	board::point pos_;
-	board::piece_type bw_;
-	bool root_ = false;
-   	bool is_leaf_ = false;
-	bool valid_ = false;
-   	Node *parent_ = nullptr;
-   	size_t wins_ = 0, visits_ = 0, rave_wins_ = 10, rave_visits_ = 20;
-   	float log_visits_ = 0.f, uct_score_;
+			all_lost = all_lost && (f & lost);
+		}
+		if (all_lost) __atomic_fetch_or(&s.flags[k], uint8_t(won), __ATOMIC_RELEASE);
+		return all_lost;
+	}
+
+	/**
+	 * the child of node i reached by move (a board bit), or none if it is not expanded
+	 */
+	index find_child(index i, unsigned move) const {
+		for (unsigned k = 0; k < children_size(i); k++) {
+			if (this->move(child(i, k)) == move) return child(i, k);
+		}
+		return none;
+	}
+
+	/**
+	 * the child of node i with the most visits, ties are broken by the wins
+	 */
+	index best_child(index i) const {
+		index first = child(i, 0), best = first;
+		for (index c = first; c < first + children_size(i); c++) {
+			if (visits(c) > visits(best) || (visits(c) == visits(best) && wins(c) > wins(best)))
+				best = c;
+		}
+		return best;
+	}
+
+protected:
+	/**
+	 * the UCT/RAVE scoring kernel of select_child() over n children, where the children flagged
+	 * as lost are skipped, return n if all of them are
+	 */
+	static unsigned score(const uint32_t* visits, const uint32_t* wins, const uint32_t* rave_visits,
+			const uint32_t* rave_wins, const uint8_t* flags, unsigned n, float log_n) {
+		unsigned k = 0, best = 0;
+		float max = -1.f;
+#if defined(__AVX2__)
+		__m256 c = _mm256_set1_ps(log_n), q = _mm256_set1_ps(0.25f);
+		__m256 vmax = _mm256_set1_ps(-1.f);
+		__m256i vbest = _mm256_setzero_si256(), index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		for (; k + 8 <= n; k += 8) {
+			__m256 v = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(visits + k)));
+			__m256 w = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(wins + k)));
+			__m256 rv = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rave_visits + k)));
+			__m256 rw = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rave_wins + k)));
+			__m256 x = _mm256_div_ps(_mm256_add_ps(_mm256_add_ps(rw, w), _mm256_mul_ps(q, _mm256_sqrt_ps(_mm256_mul_ps(c, v)))),
+				_mm256_add_ps(rv, v));
+			__m256i f = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(flags + k)));
+			__m256i open = _mm256_cmpeq_epi32(_mm256_and_si256(f, _mm256_set1_epi32(lost)), _mm256_setzero_si256());
+			__m256 gt = _mm256_and_ps(_mm256_cmp_ps(x, vmax, _CMP_GT_OQ), _mm256_castsi256_ps(open));
+			vmax = _mm256_blendv_ps(vmax, x, gt);
+			vbest = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(vbest), _mm256_castsi256_ps(index), gt));
+			index = _mm256_add_epi32(index, _mm256_set1_epi32(8));
+		}
+		alignas(32) float lane[8];
+		alignas(32) uint32_t at[8];
+		_mm256_store_ps(lane, vmax);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(at), vbest);
+		for (unsigned l = 0; l < 8; l++) {
+			if (lane[l] > max || (lane[l] == max && at[l] < best)) max = lane[l], best = at[l];
+		}
+#elif defined(__SSE2__)
+		__m128 c = _mm_set1_ps(log_n), q = _mm_set1_ps(0.25f);
+		__m128 vmax = _mm_set1_ps(-1.f);
+		__m128i vbest = _mm_setzero_si128(), index = _mm_setr_epi32(0, 1, 2, 3);
+		for (; k + 4 <= n; k += 4) {
+			__m128 v = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(visits + k)));
+			__m128 w = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(wins + k)));
+			__m128 rv = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rave_visits + k)));
+			__m128 rw = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rave_wins + k)));
+			__m128 x = _mm_div_ps(_mm_add_ps(_mm_add_ps(rw, w), _mm_mul_ps(q, _mm_sqrt_ps(_mm_mul_ps(c, v)))),
+				_mm_add_ps(rv, v));
+			__m128i f = _mm_setr_epi32(flags[k], flags[k + 1], flags[k + 2], flags[k + 3]);
+			__m128i open = _mm_cmpeq_epi32(_mm_and_si128(f, _mm_set1_epi32(lost)), _mm_setzero_si128());
+			__m128 gt = _mm_and_ps(_mm_cmpgt_ps(x, vmax), _mm_castsi128_ps(open));
+			vmax = _mm_or_ps(_mm_and_ps(gt, x), _mm_andnot_ps(gt, vmax));
+			__m128i take = _mm_castps_si128(gt);
+			vbest = _mm_or_si128(_mm_and_si128(take, index), _mm_andnot_si128(take, vbest));
+			index = _mm_add_epi32(index, _mm_set1_epi32(4));
+		}
+		alignas(16) float lane[4];
+		alignas(16) uint32_t at[4];
+		_mm_store_ps(lane, vmax);
+		_mm_store_si128(reinterpret_cast<__m128i*>(at), vbest);
+		for (unsigned l = 0; l < 4; l++) {
+			if (lane[l] > max || (lane[l] == max && at[l] < best)) max = lane[l], best = at[l];
+		}
+#endif
+		for (; k < n; k++) {
+			if (flags[k] & lost) continue;
+			float x = (float(rave_wins[k]) + float(wins[k]) + 0.25f * std::sqrt(log_n * float(visits[k])))
+				/ (float(rave_visits[k]) + float(visits[k]));
+			if (x > max) max = x, best = k;
+		}
+		return max < 0 ? n : best; // the scores are positive
+	}
+
+protected:
+	/**
+	 * the expanded node at the position of the given hash, or none if it is not in the table
+	 * an entry is written by clearing its key, setting its node, and publishing its key, so the
+	 * node read between two equal loads of the key belongs to that key
+	 */
+	index find(uint64_t hash) const {
+		const uint64_t key = salted(hash);
+		for (entry* e = table.get() + (key & mask); e != table.get() + (key & mask) + 2; e++) {
+			if (e->key.load(std::memory_order_acquire) != key) continue;
+			index node = e->node.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (e->key.load(std::memory_order_relaxed) == key) return node;
+		}
+		return none;
+	}
+	void store(uint64_t hash, index node) {
+		const uint64_t key = salted(hash);
+		entry* e = table.get() + (key & mask);
+		// replace an empty entry or one of the same position, otherwise the one with fewer visits,
+		// where the node of an entry of a past generation may be beyond the nodes in use
+		auto value = [&](const entry* e) -> uint64_t {
+			index n = e->node.load(std::memory_order_relaxed);
+			return e->key.load(std::memory_order_relaxed) == key || n >= size() ? 0 : uint64_t(visits(n)) + 1;
+		};
+		if (value(e + 1) < value(e)) e++;
+		e->key.store(0, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		e->node.store(node, std::memory_order_relaxed);
+		e->key.store(key, std::memory_order_release);
+	}
+	/**
+	 * the hash mixed with the generation, so that the entries of a past generation, i.e.,
+	 * before the last reset(), do not match, and the key 0 is reserved for empty entries
+	 */
+	uint64_t salted(uint64_t hash) const {
+		return (hash ^ (generation * 0x9e3779b97f4a7c15ull)) | 1;
+	}
+
+private:
+	// won and lost are proven for the player who moved into the node
+	enum flag : uint8_t { claimed = 1, leaf = 2, won = 4, lost = 8 };
+	struct slab {
+		uint32_t visits[slab_size];
+		uint32_t wins[slab_size];
+		uint32_t rave_visits[slab_size];
+		uint32_t rave_wins[slab_size];
+		index children[slab_size];
+		uint8_t move[slab_size];
+		uint8_t size[slab_size];
+		uint8_t flags[slab_size];
+	};
+
+	/**
+	 * set the moves of the fresh children from c.move[j] in the descending order of their mobility
+	 * gains by who at b, ties by the board bits, and bias their RAVE wins by the gains
+	 */
+	static void prioritize(slab& c, unsigned j, board::bitboard moves, const board& b, board::piece_type who) {
+		std::array<std::pair<int, unsigned>, board::bits> order;
+		unsigned n = 0;
+		while (moves) {
+			unsigned m = moves.pop();
+			order[n++] = std::make_pair(-b.mobility(m, who), m);
+		}
+		std::sort(order.begin(), order.begin() + n);
+		for (unsigned k = 0; k < n; k++) {
+			int prior = std::max(-int(prior_wins), std::min(-order[k].first, int(prior_wins)));
+			c.move[j + k] = order[k].second;
+			c.rave_wins[j + k] = rave_wins_init + prior;
+		}
+	}
+	/**
+	 * copy the node i of nodes to the node j of this tree, except its children
+	 */
+	void copy(index j, const tree& nodes, index i) {
+		slab& s = of(j);
+		const slab& t = nodes.of(i);
+		unsigned k = j % slab_size, l = i % slab_size;
+		s.visits[k] = t.visits[l];
+		s.wins[k] = t.wins[l];
+		s.rave_visits[k] = t.rave_visits[l];
+		s.rave_wins[k] = t.rave_wins[l];
+		s.children[k] = none;
+		s.move[k] = t.move[l];
+		s.size[k] = t.size[l];
+		s.flags[k] = t.flags[l];
+	}
+	slab& of(index i) { return *slabs[i / slab_size].load(std::memory_order_relaxed); }
+	const slab& of(index i) const { return *slabs[i / slab_size].load(std::memory_order_relaxed); }
+
+	std::atomic<slab*> slabs[max_slabs];
+	std::atomic<index> used;
+	std::atomic<bool> exhausted; // an allocation has failed since the last reset()
+	std::mutex growing;
+
+	struct entry {
+		std::atomic<uint64_t> key;
+		std::atomic<index> node;
+		entry() : key(0), node(none) {}
+	};
+	std::unique_ptr<entry[]> table;
+	uint64_t mask = 0, generation;
+	bool widening = false;
 };
 
 
+/**
+ * a calling thread and (size - 1) helper threads that run jobs together,
+ * e.g., the playouts of a leaf in the leaf parallel MCTS
+ */
+class team {
+public:
+	explicit team(unsigned size) : job(nullptr), round(0), busy(0), quit(false) {
+		for (unsigned k = 1; k < size; k++) helpers.emplace_back(&team::serve, this, k);
+	}
+	~team() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+			round++;
+		}
+		start.notify_all();
+		for (std::thread& helper : helpers) helper.join();
+	}
+
+	unsigned size() const { return helpers.size() + 1; }
+
+	/**
+	 * run job(k) on member k of the team, where member 0 is the calling thread, and wait for all
+	 */
+	void run(const std::function<void(unsigned)>& job) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			this->job = &job;
+			busy = helpers.size();
+			round++;
+		}
+		start.notify_all();
+		job(0);
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this]() { return busy == 0; });
+	}
+
+protected:
+	void serve(unsigned k) {
+		for (unsigned seen = 0; ; ) {
+			const std::function<void(unsigned)>* next;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				start.wait(lock, [&]() { return round != seen; });
+				if (quit) return;
+				seen = round;
+				next = job;
+			}
+			(*next)(k);
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--busy == 0) done.notify_one();
+		}
+	}
+
+private:
+	std::vector<std::thread> helpers;
+	const std::function<void(unsigned)>* job;
+	unsigned round, busy;
+	bool quit;
+	std::mutex mutex;
+	std::condition_variable start, done;
+};
+
 class MCTSAgent : public random_agent {
 public:
 	using hclock = std::chrono::high_resolution_clock;
@@ -321,7 +685,7 @@ public:
 	//const static int threshold_time = 1;
 
 	MCTSAgent(const std::string& args = "") : random_agent("name=MCTSAgent role=unknown " + args),
-		space(board::size_x * board::size_y), who(board::empty) {
+		who(board::empty) {
 		if (name().find_first_of("[]():; ") != std::string::npos)
 			throw std::invalid_argument("invalid name: " + name());
 		if (role() == "black") who = board::black;
@@ -339,281 +703,833 @@ public:
 			else
 				throw std::invalid_argument("invalid simulation: " + simulation());
 		}
-		for (size_t i = 0; i < space.size(); i++)
-			space[i] = action::place(i, who);
+		// search threads sharing the tree
+		if (meta.find("threads") != meta.end()) {
+			thread_count = int(meta["threads"]);
+			if (thread_count <= 0)
+				throw std::invalid_argument("invalid threads: " + property("threads"));
+		}
+		// time control: time=<seconds of our moves in a game> move_time=<seconds per move>
+		// with only time=, a move takes a share of the time left, see move_budget()
+		if (meta.find("time") != meta.end()) {
+			game_time = double(meta["time"]);
+			if (game_time <= 0)
+				throw std::invalid_argument("invalid time: " + property("time"));
+			move_time = std::numeric_limits<double>::infinity();
+		}
+		if (meta.find("move_time") != meta.end()) {
+			move_time = move_cap = double(meta["move_time"]);
+			if (move_time <= 0)
+				throw std::invalid_argument("invalid move_time: " + property("move_time"));
+		}
+		reset_clock();
+		// search in the background during the opponent's turn, e.g., ponder=1 for the GTP shell
+		if (meta.find("ponder") != meta.end())
+			ponder = int(meta["ponder"]);
+		// playout policy: pattern (by default, see pattern_playout) or uniform
+		if (meta.find("policy") != meta.end()) {
+			if (property("policy") == "uniform") patterns = false;
+			else if (property("policy") != "pattern")
+				throw std::invalid_argument("invalid policy: " + property("policy"));
+		}
+		// playouts of each leaf, backed up together
+		if (meta.find("playouts") != meta.end()) {
+			playout_count = int(meta["playouts"]);
+			if (playout_count <= 0)
+				throw std::invalid_argument("invalid playouts: " + property("playouts"));
+		}
+		// the endgame is solved exactly once the legal moves of both players are at most solve= in
+		// total (32 by default, 0 disables), and the solver reports to stderr with verbose=1
+		if (meta.find("solve") != meta.end()) {
+			if (int(meta["solve"]) < 0)
+				throw std::invalid_argument("invalid solve: " + property("solve"));
+			solve_limit = int(meta["solve"]);
+		}
+		if (meta.find("verbose") != meta.end())
+			verbose = int(meta["verbose"]);
+		// parallelization of the threads: tree (shared tree, by default), root (a tree per thread),
+		// or leaf (one search thread, whose playouts of each leaf are shared by the threads)
+		bool root_parallel = false, leaf_parallel = false;
+		if (meta.find("parallel") != meta.end()) {
+			if (property("parallel") == "root") root_parallel = true;
+			else if (property("parallel") == "leaf") leaf_parallel = true;
+			else if (property("parallel") != "tree")
+				throw std::invalid_argument("invalid parallel: " + property("parallel"));
+		}
+		for (int k = 0; k < (root_parallel ? thread_count : 1); k++)
+			trees.emplace_back(new tree());
+		roots.assign(trees.size(), tree::none);
+		// the nodes at the same position share their children through a transposition table
+		// of (1 << tt) entries in each tree, e.g., tt=20, see tree::share()
+		if (meta.find("tt") != meta.end()) {
+			int bits = int(meta["tt"]);
+			if (bits < 0 || bits > 30)
+				throw std::invalid_argument("invalid tt: " + property("tt"));
+			for (auto& nodes : trees) nodes->share(bits);
+		}
+		// progressive widening of the children in the order of their mobility priors (by default),
+		// which is disabled by widening=0
+		bool widening = true;
+		if (meta.find("widening") != meta.end())
+			widening = int(meta["widening"]);
+		for (auto& nodes : trees) nodes->widen(widening);
+		if (leaf_parallel && thread_count > 1) {
+			leaf_team.reset(new team(thread_count));
+			for (int k = 1; k < thread_count; k++) team_engines.emplace_back(engine());
+		}
+		tallies.resize(team_engines.size());
+	}
+
+	virtual ~MCTSAgent() { stop_pondering(); }
+
+	virtual void close_episode(const std::string& flag = "") {
+		stop_pondering();
+		//drop whole tree, the slabs are kept for the next episode
+		for(size_t k = 0; k < trees.size(); k++){
+			trees[k]->reset();
+			roots[k] = tree::none;
+		}
+		first_time = true;
+		reset_clock();
+	}
+
+	/**
+	 * the clock given by the controller, which replaces the time options of the agent
+	 * except move_time, and no main time nor byo-yomi stones means no time limit
+	 */
+	virtual void set_time(double main_time, double byo_yomi_time, int byo_yomi_stones) {
+		game_time = main_time;
+		byo_time = byo_yomi_stones > 0 ? byo_yomi_time : 0;
+		byo_stones = std::max(byo_yomi_stones, 0);
+		move_time = std::isinf(move_cap) && !timed() ? 1 : move_cap;
+		reset_clock();
+	}
+	virtual void set_time_left(double time, int stones) {
+		time_left = time;
+		stones_left = stones;
+	}
+
+	virtual void analyze(const board& state, double interval, const std::function<void(const std::string&)>& report) {
+		if(activate_MCTS == false) return;
+		stop_pondering();
+		follow(state);
+		start_pondering((who == board::black)?board::white:board::black, [=]() { report(analysis()); }, interval);
 	}
+	virtual void end_analysis() { stop_pondering(); }
+
+	/**
+	 * run one simulation from the root of nodes at state, which is the position after a move
+	 * of root_bw: select, expand, play out, and back up
+	 * the visits are counted on the way down as a virtual loss, so that other threads
+	 * searching the same tree avoid the path until the result is backed up
+	 * the simulation stops at a proven node, whose result is backed up without playouts,
+	 * and the backup proves the nodes on the path, see tree::solve()
+	 */
+	void simulate(const board& state, board::piece_type root_bw, tree& nodes, tree::index root,
+			std::default_random_engine& rng) {
+		// root_bw made the move leading to the root, and the other player is to move at the root
+		const board::piece_type root_next = (root_bw == board::black)?board::white:board::black;
+		// the nodes from the root to the simulated node
+		std::array<tree::index, board::size_x * board::size_y + 2> path;
+		tree::index node = root;
+		size_t depth = 0;
+		path[depth++] = node;
+		nodes.visit(node, playout_count);
+		board after = state;
+		//black and white moves as board bits, for rave use
+		board::bitboard bpos, wpos;
+		board::piece_type bw = root_bw;
+		board::point pos;
+		while(nodes.has_children(node) && !nodes.is_solved(node)){
+			//printf("has children\n");
+			node = nodes.select_child(node);
+			path[depth++] = node;
+			nodes.visit(node, playout_count);
+			bw = (bw == board::black)?board::white:board::black;
+			pos = board::at(nodes.move(node));
+			after.play_unchecked(pos, bw); // children are expanded with legal moves only
+			if(bw == board::black){
+				bpos.set(nodes.move(node));
+			}
+			else{
+				wpos.set(nodes.move(node));
+			}
+		}
+		if(!nodes.is_solved(node) && nodes.expand(node, after, (bw == board::black)?board::white:board::black, playout_count)){
+			node = nodes.select_child(node);
+			path[depth++] = node;
+			nodes.visit(node, playout_count);
+			bw = (bw == board::black)?board::white:board::black;
+			pos = board::at(nodes.move(node));
+			//printf("%d\n", node->children_size_);
+			after.play_unchecked(pos, bw);
+			if(bw == board::black){
+				bpos.set(nodes.move(node));
+			}
+			else{
+				wpos.set(nodes.move(node));
+			}
+		}
+
+		//printf("expand end\n");
 
-	void deleteNode(Node *root){
-		if(root != nullptr){
-			for(size_t i = 0; i < root->children_size_; i++){
-				deleteNode(&root->children_[i]);
+		//simulate, the playouts of the leaf are shared by the team in leaf parallel mode
+		board::piece_type take_turn = (bw == board::black)?board::white:board::black;
+		// member k of the team runs the playouts k, k + members, ..., and member 0 is this thread
+		const int members = leaf_team ? leaf_team->size() : 1;
+		unsigned wins[3] = {};
+		if(nodes.is_solved(node)){
+			wins[nodes.is_won(node) ? bw : take_turn] = playout_count;
+		}
+		else{
+			tally mine;
+			auto batch = [&](unsigned k) {
+				tally &t = k ? tallies[k - 1] : mine;
+				std::default_random_engine &r = k ? team_engines[k - 1] : rng;
+				t.clear();
+				if(patterns) play_out<pattern_playout>(after, take_turn, r, t.wins, t.bpos, t.wpos, k, members);
+				else play_out<playout>(after, take_turn, r, t.wins, t.bpos, t.wpos, k, members);
+			};
+			if(leaf_team) leaf_team->run(batch);
+			else batch(0);
+			for(int k = 0; k < members; k++){
+				const tally &t = k ? tallies[k - 1] : mine;
+				wins[board::black] += t.wins[board::black];
+				wins[board::white] += t.wins[board::white];
+				bpos |= t.bpos;
+				wpos |= t.wpos;
 			}
-			if(root->children_size_ == 0) return;
-			delete[] root->children_;
+		}
+
+		bool proven = true;
+		while(depth--){
+			// the player who moved into the node, and the other player's moves for RAVE
+			bw = (depth % 2 == 0)?root_bw:root_next;
+			nodes.update(path[depth], wins[bw], playout_count, (bw == board::black)?wpos:bpos);
+			if(proven) proven = nodes.solve(path[depth]);
 		}
 	}
 
-	virtual void close_episode(const std::string& flag = "") {
-		//delete whole tree
-		deleteNode(init_root);
-		delete init_root;
-		first_time = true;
-		emp_pos_vec.clear();
-		std::vector <empty_pos>().swap(emp_pos_vec);    //清除容器并最小化它的容量，
-		// vecInt.swap(vector<int>()) ; //另一种写法
-		int j= emp_pos_vec.capacity();           //j=0
-		int i = emp_pos_vec.size();              //i=0
-		emp_pos_vec_size = 0;
-		emp_pos_count = 0;
-		if(root != nullptr)
-			root = nullptr;
+	/**
+	 * run the playouts k, k + members, ... of a leaf at state with who to move by the given policy,
+	 * count the wins of each player, and record the moves of black and white in bpos and wpos
+	 */
+	template<class policy>
+	void play_out(const board& state, board::piece_type who, std::default_random_engine& rng,
+			unsigned (&wins)[3], board::bitboard& bpos, board::bitboard& wpos, int k, int members) {
+		policy engine;
+		for(int n = k; n < playout_count; n += members){
+			board b = state;
+			wins[engine.run(b, who, rng, bpos, wpos)] += 1;
+		}
 	}
 
 	virtual action take_action(const board& state) {
 
 		if(activate_MCTS == false){
 			//test
-			std::shuffle(space.begin(), space.end(), engine);
-			for (const action::place& move : space) {
-				board after = state;
-				if (move.apply(after) == board::legal)
-					return move;
-			}
-			return action();
+			return random_move(state, who);
 		}
+		// the statistics of pondering stay in the tree, which descends into the opponent's move below
+		stop_pondering();
 
 		//printf("take turn!!!\n");
 
-		size_t total_counts = 0;
 		const auto start_time = hclock::now();
-		if(first_time){
-			first_time = false;
-			last_board = state;
-			layout = last_board.get_stone();
-			last_layout = layout;
-			root = new Node();
-			root->init_root();
-			init_root = root;
-			
-			if(who == board::black){
-				root->init_bw(board::white);
-			}
-			else{
-				root->init_bw(board::black);
+		follow(state);
+		// the root is the position after a move of the opponent
+		const auto budget = std::chrono::duration<double>(move_budget(state));
+		// the endgame is solved exactly with up to half of the budget, and searched if it is not won
+		if(solve_limit && state.legal_count(board::black) + state.legal_count(board::white) <= solve_limit){
+			unsigned move;
+			const solver::result result = endgame.solve(state, who,
+				start_time + std::chrono::duration_cast<hclock::duration>(budget / 2), move);
+			if(verbose){
+				std::cerr << name() << " solver: " << (result == solver::win ? "win at " + std::string(board::at(move))
+					: result == solver::loss ? "loss" : "unknown") << ", " << endgame.nodes() << " nodes in "
+					<< endgame.seconds() << " s";
+				// the rate of a short solve is mostly the timer resolution, so it is only shown for a long one
+				if(endgame.seconds() >= 0.01) std::cerr << ", " << uint64_t(endgame.nodes() / endgame.seconds()) << " nodes/s";
+				std::cerr << std::endl;
 			}
-			
-			//root->init_bw(who);
-
-			empty_pos tmp_pos;
-			for(int x = 0; x < board::size_x; x++){
-				for(int y = 0; y < board::size_y; y++){
-					if(layout[x][y] == board::empty){
-						//tmp_pos.pos.x = x;
-						//tmp_pos.pos.y = y;
-						//tmp_pos.pos.i = x + y*9;
-						tmp_pos.pos = board::point(x,y);
-						//printf("tmp_pos: %d,%d,%d\n", tmp_pos.pos.x, tmp_pos.pos.y, tmp_pos.pos.i);
-						emp_pos_vec.push_back(tmp_pos);
-						emp_pos_count++;
-					}
-				}
+			if(result == solver::win){
+				charge(seconds(hclock::now() - start_time));
+				return play(move);
 			}
-			emp_pos_vec_size = emp_pos_count;
 		}
-		else{
-			board::point tmp_pos;
-			bool find_pos = false;
-			last_layout = last_board.get_stone();
-			last_board = state;
-			layout = last_board.get_stone();
-			for(int x = 0; x < board::size_x; x++){
-				for(int y = 0; y < board::size_y; y++){
-					if(layout[x][y] != last_layout[x][y]){
-						//tmp_pos.x = x;
-						//tmp_pos.y = y;
-						tmp_pos = board::point(x,y);
-						//printf("tmp_pos: %d,%d,%d\n", tmp_pos.x, tmp_pos.y, tmp_pos.i);
-						find_pos = true;
-						break;
-					}
-				}
-				if(find_pos == true) break;
-			}
+		search_from(state, (who == board::black)?board::white:board::black, simulation_count,
+			start_time + std::chrono::duration_cast<hclock::duration>(budget));
+		charge(seconds(hclock::now() - start_time));
 
-			bool find_child = false;
-			for(int i = 0; i < root->children_size_; i++){
-				if(root->children_[i].pos_.x == tmp_pos.x && root->children_[i].pos_.y == tmp_pos.y){
-					root = &root->children_[i];
-					find_child = true;
-					break;
-				}
-			}
-			if(find_child == false){
-				delete root;
-				root = new Node();
-				if(who == board::black){
-					root->init_bw(board::white);
-				}
-				else{
-					root->init_bw(board::black);
-				}
+		// sum the statistics of the root children over the trees, and take the most visited move,
+		// where a proven win is taken first, and a proven loss only if all the moves are lost
+		std::array<uint64_t, board::bits> visits = {}, wins = {};
+		board::bitboard won, lost;
+		board::bitboard moves = root_moves(visits, wins, won, lost);
+		if(!moves){ // the root is not expanded, so the move with the best mobility is played
+			board::bitboard legal = state.legal_moves(who);
+			if(!legal) return action(); // no legal move to play
+			unsigned best = legal.lsb();
+			int gain = state.mobility(best, who);
+			while(legal){
+				unsigned b = legal.pop();
+				int g = state.mobility(b, who);
+				if(g > gain) best = b, gain = g;
 			}
-			//新的root，上面的就不理了
-			root->init_root();
-		}
-		// Node root;
-		do{
-			Node *node = root;
-			board after = state;
-			//black move, for rave use
-			//std::vector<int> bpos;
-			std::set<int> bpos;
-			//white move,for rave use
-			//std::vector<int> wpos;
-			std::set<int> wpos;
-			board::piece_type bw;
-			board::point pos;
-			while(node->has_children()){
-				//printf("has children\n");
-				node = &node->children_[node->select_child(bw, pos)];
-				after.place(pos, bw);
-				if(bw == board::black){
-					//bpos.push_back(pos.i);
-					bpos.insert(pos.i);
-				}
-				else{
-					//wpos.push_back(pos.i);
-					wpos.insert(pos.i);
+			return play(best);
+		}
+		if(won) moves = won;
+		else if(moves != lost) moves &= ~lost;
+
+		unsigned best = moves.lsb();
+		while(moves){
+			unsigned b = moves.pop();
+			if(visits[b] > visits[best] || (visits[b] == visits[best] && wins[b] > wins[best]))
+				best = b;
+		}
+		return play(best);
+	}
+
+protected:
+	/**
+	 * play our move (a board bit) at the roots and last_board, and ponder after it if enabled
+	 */
+	action play(unsigned move) {
+		for(size_t k = 0; k < trees.size(); k++)
+			roots[k] = descend(*trees[k], roots[k], move);
+		board::point best_move = board::at(move);
+		int tmp = last_board.place(best_move, who);
+		if(tmp == board::legal){
+			if(ponder) start_pondering(who);
+			return action::place(best_move, who);
+		}
+
+		return action();
+	}
+
+	/**
+	 * search the trees from state, which is the position after a move of root_bw, until
+	 * each worker has run its share of the simulations, the root of its tree is proven, its pool is full,
+	 * the deadline has passed, or keep_going() returns false, but after at least two simulations
+	 * with a deadline, a worker also stops once the most visited root child of its tree
+	 * cannot be overtaken by the visits the tree can still get before the deadline
+	 *
+	 * the first worker runs on this thread with the agent's engine, and the workers share
+	 * trees[0] unless the search is root parallel, in which case worker k builds trees[k]
+	 * alone without any synchronization
+	 */
+	void search_from(const board& state, board::piece_type root_bw, int simulations,
+			hclock::time_point deadline = hclock::time_point::max(),
+			const std::function<bool()>& keep_going = nullptr) {
+		const int searchers = leaf_team ? 1 : thread_count;
+		const int share = simulations / searchers + (simulations % searchers != 0);
+		// the workers that add visits to a tree
+		const int per_tree = trees.size() == 1 ? searchers : 1;
+		const auto start = hclock::now();
+		auto run = [&](int k, std::default_random_engine& rng) {
+			tree &nodes = *trees[k % trees.size()];
+			const tree::index root = roots[k % trees.size()];
+			for(int counts = 1; ; counts++){
+				simulate(state, root_bw, nodes, root, rng);
+				if(nodes.is_solved(root) || nodes.full()) break;
+				// the root is expanded on its second visit, so a move is only known after two simulations
+				if(counts < 2) continue;
+				if(counts >= share || (keep_going && !keep_going())) break;
+				if(deadline == hclock::time_point::max()) continue;
+				const auto now = hclock::now();
+				if(now >= deadline) break;
+				if(counts % 64 == 0){
+					const double rate = counts / seconds(now - start) * per_tree;
+					const double more = std::min(rate * seconds(deadline - now), double(share - counts) * per_tree);
+					if(settled(nodes, root, more * playout_count)) break;
 				}
 			}
-			if(node->expand(after, emp_pos_vec, emp_pos_count)){
-				//printf("%d\n", node->children_size_);
-				node = &node->children_[node->select_child(bw, pos)];
-				//printf("%d\n", node->children_size_);
-				after.place(pos, bw);
-				if(bw == board::black){
-					//bpos.push_back(pos.i);
-					bpos.insert(pos.i);
-				}
-				else{
-					//wpos.push_back(pos.i);
-					wpos.insert(pos.i);
-				}
+		};
+		std::vector<std::default_random_engine> engines;
+		for(int k = 1; k < searchers; k++) engines.emplace_back(engine());
+		std::vector<std::thread> workers;
+		for(int k = 1; k < searchers; k++) workers.emplace_back([&, k]() { run(k, engines[k - 1]); });
+		run(0, engine);
+		for(std::thread &worker : workers) worker.join();
+	}
+
+	/**
+	 * whether the most visited child of root leads the others by more than the given visits
+	 */
+	static bool settled(const tree& nodes, tree::index root, double more) {
+		unsigned first = 0, second = 0;
+		for(unsigned i = 0; i < nodes.children_size(root); i++){
+			unsigned v = nodes.visits(nodes.child(root, i));
+			if(v > first) second = first, first = v;
+			else if(v > second) second = v;
+		}
+		return first > second + more;
+	}
+
+	/**
+	 * the time in seconds for the next move at state: the per-move limit, and, if the time
+	 * of the game is limited, a share of the time left that is larger when more legal moves
+	 * remain, i.e., more in the high-branching opening and midgame, less in the endgame
+	 * in byo-yomi, the moves left in the period share its time evenly, and in main time, a move
+	 * may take at least its share of the byo-yomi that follows
+	 */
+	double move_budget(const board& state) const {
+		double limit = move_time;
+		// a tenth is kept for the overhead of the move, e.g., the lag of the controller
+		const double margin = 0.9;
+		if(stones_left > 0){
+			limit = std::min(limit, time_left / stones_left * margin);
+		}
+		else if(timed()){
+			const double legal = state.legal_count(who), cells = board::playable().count();
+			// about half of the legal moves are left for us, weighted by the branching
+			double share = std::min(time_left / (legal / 2 + 2) * (0.5 + legal / cells), time_left / 2);
+			if(byo_stones > 0) share = std::max(share, byo_time / byo_stones * margin);
+			limit = std::min(limit, share);
+		}
+		// at least a millisecond, so that the search always has a chance to expand the root
+		return std::max(limit, 0.001);
+	}
+
+	/**
+	 * whether the game is played with a clock, i.e., main time or byo-yomi
+	 */
+	bool timed() const { return game_time > 0 || byo_stones > 0; }
+
+	/**
+	 * charge the clock for a move which took elapsed seconds, and enter the byo-yomi, or
+	 * a new period of it, once the main time, or the current period, is used up
+	 */
+	void charge(double elapsed) {
+		if(!timed()) return;
+		time_left -= elapsed;
+		if(stones_left == 0 && time_left <= 0 && byo_stones > 0){
+			time_left += byo_time;
+			stones_left = byo_stones;
+		}
+		if(stones_left > 0 && --stones_left == 0){
+			time_left = byo_time;
+			stones_left = byo_stones;
+		}
+	}
+	void reset_clock() {
+		time_left = game_time > 0 ? game_time : byo_time;
+		stones_left = game_time > 0 ? 0 : byo_stones;
+	}
+
+	static double seconds(hclock::duration d) { return std::chrono::duration<double>(d).count(); }
+
+	/**
+	 * keep searching in the background from last_board, the position after a move of root_bw,
+	 * until stop_pondering() is called or this session has added ponder_nodes nodes to the tree
+	 * (the tree also keeps the subtrees left behind by the earlier moves until the episode ends)
+	 * this ponders after our move, or analyzes the position with us to move, in which case
+	 * report is called every interval seconds by another thread
+	 */
+	void start_pondering(board::piece_type root_bw, const std::function<void()>& report = nullptr,
+			double interval = 1) {
+		pondering_stop = false;
+		const size_t start = trees[0]->size();
+		pondering = std::thread([this, root_bw, start]() {
+			search_from(last_board, root_bw, std::numeric_limits<int>::max(), hclock::time_point::max(), [this, start]() {
+				return !pondering_stop.load(std::memory_order_relaxed) && trees[0]->size() - start < ponder_nodes;
+			});
+		});
+		if (!report) return;
+		reported = 0;
+		reported_at = hclock::now();
+		reporting = std::thread([this, report, interval]() {
+			const auto period = std::chrono::duration_cast<hclock::duration>(std::chrono::duration<double>(interval));
+			for (auto next = hclock::now() + period; ; next += period) {
+				std::unique_lock<std::mutex> lock(stopping);
+				if (stopped.wait_until(lock, next, [this]() { return pondering_stop.load(); })) return;
+				lock.unlock();
+				report();
 			}
+		});
+	}
+	void stop_pondering() {
+		if (!pondering.joinable()) return;
+		{
+			std::lock_guard<std::mutex> lock(stopping);
+			pondering_stop = true;
+		}
+		stopped.notify_all();
+		pondering.join();
+		if (reporting.joinable()) reporting.join();
+	}
 
-			//printf("expand end\n");
-
-			//simulate
-			board::piece_type winner = board::empty;
-			board::piece_type take_turn = (node->bw_ == board::black)?board::white:board::black;
-			//std::vector<empty_pos> tmp_vec;
-			//tmp_vec.assign(emp_pos_vec.begin(), emp_pos_vec.end());
-			//std::shuffle(tmp_vec.begin(), tmp_vec.end(), engine);
-			//std::shuffle(emp_pos_vec.begin(), emp_pos_vec.end(), engine);
-			bool has_move = false;
-			while(1){
-				std::vector<empty_pos> tmp_vec;
-				tmp_vec.assign(emp_pos_vec.begin(), emp_pos_vec.end());
-				std::shuffle(tmp_vec.begin(), tmp_vec.end(), engine);
-				//printf("stuck in this?!\n");
-				for (empty_pos &move : tmp_vec){
-					if(move.use != true){
-						if(after.place(move.pos, take_turn) == board::legal){
-							move.use = true;
-							has_move = true;
-							if(take_turn == board::black){
-								//bpos.push_back(move.pos.i);
-								bpos.insert(move.pos.i);
-							}
-							else{
-								//wpos.push_back(move.pos.i);
-								wpos.insert(move.pos.i);
-							}
-							break;
-						}
-					}
-				}
-				if(has_move){
-					take_turn = (take_turn == board::black)?board::white:board::black;
-					has_move = false;
-				}
-				else{
-					winner = (take_turn == board::black)?board::white:board::black;
-					break;
-				}
+	/**
+	 * the visits and wins of the moves (board bits) at the roots, summed over the trees, and
+	 * the moves proven to win or lose in any tree, return the moves, none if the roots are
+	 * not expanded
+	 */
+	board::bitboard root_moves(std::array<uint64_t, board::bits>& visits, std::array<uint64_t, board::bits>& wins,
+			board::bitboard& won, board::bitboard& lost) const {
+		board::bitboard moves;
+		for(size_t k = 0; k < trees.size(); k++){
+			const tree &nodes = *trees[k];
+			for(unsigned i = 0; i < nodes.children_size(roots[k]); i++){
+				tree::index child = nodes.child(roots[k], i);
+				visits[nodes.move(child)] += nodes.visits(child);
+				wins[nodes.move(child)] += nodes.wins(child);
+				moves.set(nodes.move(child));
+				if(nodes.is_won(child)) won.set(nodes.move(child));
+				if(nodes.is_lost(child)) lost.set(nodes.move(child));
 			}
+		}
+		return moves;
+	}
 
-			/*
-			do
-			{
-				printf("update \n");
-				node->update(winner, bpos, wpos);
-			} while (node->root_ != true);
-			*/
-
-			while(node != nullptr){
-				node->update(winner, bpos, wpos);
-				node = node->get_parent();
+	/**
+	 * the report of the analysis: the simulations so far and per second since the last report,
+	 * then the most visited moves with their winrates and principal variations, e.g.,
+	 *   info simulations 48000 rate 24000
+	 *   info move C3 visits 800 winrate 0.5625 pv C3 D4 E5
+	 */
+	std::string analysis() {
+		std::ostringstream out;
+		uint64_t playouts = 0;
+		for(size_t k = 0; k < trees.size(); k++) playouts += trees[k]->visits(roots[k]);
+		const uint64_t simulations = playouts / playout_count;
+		const auto now = hclock::now();
+		out << "info simulations " << simulations << " rate "
+			<< uint64_t((simulations - reported) / std::max(seconds(now - reported_at), 1e-3));
+		reported = simulations;
+		reported_at = now;
+
+		std::array<uint64_t, board::bits> visits = {}, wins = {};
+		board::bitboard won, lost;
+		root_moves(visits, wins, won, lost);
+		std::vector<unsigned> moves;
+		for(unsigned b = 0; b < board::bits; b++) if(visits[b]) moves.push_back(b);
+		std::sort(moves.begin(), moves.end(), [&](unsigned x, unsigned y) { return visits[x] > visits[y]; });
+		const tree &nodes = *trees[0];
+		for(unsigned i = 0; i < moves.size() && i < analysis_moves; i++){
+			const unsigned b = moves[i];
+			out << "\ninfo move " << std::string(board::at(b)) << " visits " << visits[b] << " winrate "
+				<< std::fixed << std::setprecision(4) << double(wins[b]) / visits[b] << " pv";
+			// the most visited line after the move, in the first tree
+			tree::index node = nodes.find_child(roots[0], b);
+			for(unsigned d = 0; node != tree::none && d < analysis_depth; d++){
+				out << ' ' << std::string(board::at(nodes.move(node)));
+				node = nodes.has_children(node) ? nodes.best_child(node) : tree::none;
 			}
+		}
+		return out.str();
+	}
+
+	/**
+	 * move the roots to state, the position with us to move: the roots stay if nothing has
+	 * been played since last_board, descend into the move if the opponent has played one
+	 * stone, e.g., the reply to our move, and are fresh roots otherwise
+	 */
+	void follow(const board& state) {
+		const board::piece_type opponent = (who == board::black)?board::white:board::black;
+		const board::bitboard played = (state.stones(board::black) ^ last_board.stones(board::black))
+			| (state.stones(board::white) ^ last_board.stones(board::white));
+		if(!first_time && !played) return;
+		const bool replied = !first_time && !played.many() && (played & state.stones(opponent));
+		for(size_t k = 0; k < trees.size(); k++){
+			roots[k] = replied ? descend(*trees[k], roots[k], played.lsb()) : fresh(*trees[k]);
+			// the rest of the tree is unreachable from now on
+			if(trees[k]->size() > 1) roots[k] = trees[k]->compact(roots[k], spare);
+		}
+		first_time = false;
+		last_board = state;
+	}
 
-			//printf("%d\n", total_counts);
-
-		}while(++total_counts < simulation_count &&
-             (hclock::now() - start_time) < std::chrono::seconds(1));
-
-		//}while(++total_counts < simulation_count);
-
-		const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-                              hclock::now() - start_time)
-                              .count();
-		/*
-    	std::cerr << duration << " ms" << std::endl
-              << total_counts << " simulations" << std::endl;
-		*/
-
-		//print while testing
-		//std::cerr << duration << " ms,\t" << total_counts << " simulations" << std::endl;
-
-		/*
-		if(root->is_leaf_){
-			return action();
-		}
-		*/
-		/*
-		std::unordered_map<board::point, size_t> visits;
-    	root->get_children_visits(visits);
-    	board::point best_move = std::max_element(std::begin(visits), std::end(visits),
-                                        [](const auto &p1, const auto &p2) {
-                                          return p1.second < p2.second;
-                                        })
-                           ->first;
-		*/
-		//return action();
-		//board::point best_move = root->get_best_move();
-
-		int max = root->get_best_move();
-		root = &root->children_[max];
-		int tmp = last_board.place(root->pos_, who);
-		if(tmp == board::legal)
-			return action::place(root->pos_, who);
+	/**
+	 * the node after move (a board bit) from the root of nodes, which is a fresh root if the
+	 * move is not expanded, in which case the old tree is dropped
+	 * the subtrees of the other moves stay in the pool until follow() compacts the tree
+	 */
+	static tree::index descend(tree& nodes, tree::index root, unsigned move) {
+		tree::index child = nodes.find_child(root, move);
+		return child != tree::none ? child : fresh(nodes);
+	}
 
-		return action();
+	/**
+	 * a fresh root in nodes, where the whole tree is dropped
+	 */
+	static tree::index fresh(tree& nodes) {
+		nodes.reset();
+		return nodes.allocate(1);
 	}
 
 private:
-	std::vector<action::place> space;
 	board::piece_type who;
 	bool activate_MCTS = true;
 	board last_board;
-	Node *root = nullptr;
-	Node *init_root = nullptr;
+	// one tree shared by all the threads, or one tree per thread if the search is root parallel
+	std::vector<std::unique_ptr<tree>> trees;
+	// the pool that the kept subtrees are copied to between the moves, see tree::compact()
+	tree spare;
+	std::vector<tree::index> roots;
 	bool first_time = true;
-	board::grid last_layout;
-	board::grid layout;
-	
-	std::vector<empty_pos> emp_pos_vec;
-	int emp_pos_vec_size = 0;
-	int emp_pos_count = 0;
 
 	int simulation_count = 50000;
-};
\ No newline at end of file
+	int thread_count = 1;
+	int playout_count = 1;
+	bool patterns = true;
+
+	// the exact solver of the endgames, see solver
+	solver endgame;
+	unsigned solve_limit = 32;
+	bool verbose = false;
+
+	// the time of our moves in a game (unlimited if 0) and the limit per move, in seconds
+	double game_time = 0, move_time = 1;
+	// the per-move limit given by move_time=, which also caps the clock of set_time()
+	double move_cap = std::numeric_limits<double>::infinity();
+	// byo-yomi of byo_time seconds per byo_stones moves after the game time (none if 0)
+	double byo_time = 0;
+	int byo_stones = 0;
+	// the time left of the game time, or of the current period with stones_left moves in byo-yomi
+	double time_left = 0;
+	int stones_left = 0;
+
+	// background search during the opponent's turn, see start_pondering()
+	bool ponder = false;
+	enum { ponder_nodes = 1 << 23 };
+	std::thread pondering;
+	std::atomic<bool> pondering_stop;
+	std::mutex stopping;
+	std::condition_variable stopped;
+
+	// the reports of the analysis, see analysis()
+	enum { analysis_moves = 10, analysis_depth = 12 };
+	std::thread reporting;
+	uint64_t reported = 0;
+	hclock::time_point reported_at;
+
+	/**
+	 * the results of the playouts run by a thread for a leaf, tallies[k - 1] for helper k of the team
+	 */
+	struct tally {
+		unsigned wins[3];
+		board::bitboard bpos, wpos;
+		void clear() { wins[board::black] = wins[board::white] = 0; bpos = wpos = board::bitboard(); }
+	};
+	std::vector<tally> tallies;
+	std::unique_ptr<team> leaf_team;
+	std::vector<std::default_random_engine> team_engines;
+};
+/**
+ * alpha-beta player, which runs the principal variation search with iterative deepening until
+ * the depth limit or the time limit of the move, e.g., search=alpha-beta depth=3 move_time=1
+ *
+ * a position is evaluated by the mobility of the player to move, see evaluate(), and a position
+ * without legal move for the player to move is a loss, which is scored by its ply so that the
+ * faster wins and the slower losses are preferred
+ *
+ * the searched positions are kept in a transposition table of (1 << tt) entries (20 by default)
+ * in buckets of two, where the entry searched to a smaller depth is replaced; the moves are
+ * ordered by the best move in the table, the two killers of the ply, and the history heuristic
+ */
+class alpha_beta_agent : public agent {
+public:
+	using hclock = std::chrono::high_resolution_clock;
+
+	alpha_beta_agent(const std::string& args = "") : agent("name=alpha-beta role=unknown " + args),
+		who(board::empty) {
+		if (name().find_first_of("[]():; ") != std::string::npos)
+			throw std::invalid_argument("invalid name: " + name());
+		if (role() == "black") who = board::black;
+		if (role() == "white") who = board::white;
+		if (who == board::empty)
+			throw std::invalid_argument("invalid role: " + role());
+		// the depth limit in plies (none by default) and the time limit per move in seconds
+		if (meta.find("depth") != meta.end()) {
+			max_depth = int(meta["depth"]);
+			if (max_depth <= 0)
+				throw std::invalid_argument("invalid depth: " + property("depth"));
+		}
+		if (meta.find("move_time") != meta.end()) {
+			move_time = double(meta["move_time"]);
+			if (move_time <= 0)
+				throw std::invalid_argument("invalid move_time: " + property("move_time"));
+		}
+		unsigned bits = 20;
+		if (meta.find("tt") != meta.end()) {
+			if (int(meta["tt"]) < 1 || int(meta["tt"]) > 30)
+				throw std::invalid_argument("invalid tt: " + property("tt"));
+			bits = int(meta["tt"]);
+		}
+		table.reset(new entry[1ull << bits]());
+		mask = (1ull << bits) - 2;
+		for (auto& k : killers) k.fill(none);
+		// the depth, score, and nodes per second of each move are reported to stderr with verbose=1
+		if (meta.find("verbose") != meta.end())
+			verbose = int(meta["verbose"]);
+	}
+
+	virtual void close_episode(const std::string& flag = "") {
+		time_left = 0;
+		stones_left = 0;
+	}
+
+	/**
+	 * the clock given by the controller, where a move may take a share of the time left
+	 */
+	virtual void set_time_left(double time, int stones) {
+		time_left = time;
+		stones_left = stones;
+	}
+
+	virtual action take_action(const board& state) {
+		const auto start = hclock::now();
+		const board::bitboard moves = state.legal_moves(who);
+		if (state.info().who_take_turns != who || !moves) return action();
+
+		double budget = move_time;
+		if (time_left > 0) { // a tenth is kept for the overhead of the move
+			const double share = stones_left > 0 ? time_left / stones_left : time_left / (state.legal_count(who) / 2 + 2);
+			budget = std::min(budget, share * 0.9);
+		}
+		deadline = start + std::chrono::duration_cast<hclock::duration>(std::chrono::duration<double>(budget));
+		aborted = false;
+		count = 0;
+		for (auto& h : history) for (auto& x : h) x /= 2;
+
+		// the best move of the deepest search completed, or the lowest move if none is
+		unsigned best = moves.lsb();
+		int score = 0, depth = 0;
+		for (int d = 1; d <= max_depth; d++) {
+			int s = search(state, who, d, -infinity, infinity, 0);
+			if (aborted) break;
+			best = root_move;
+			score = s;
+			depth = d;
+			if (std::abs(s) >= win_score - int(board::bits)) break; // proven
+		}
+		if (verbose) {
+			const double elapsed = std::chrono::duration<double>(hclock::now() - start).count();
+			std::cerr << name() << " alpha-beta: " << std::string(board::at(best)) << ", depth " << depth
+				<< ", score " << score << ", " << count << " nodes in " << elapsed << " s, "
+				<< uint64_t(count / std::max(elapsed, 1e-6)) << " nodes/s" << std::endl;
+		}
+		return action::place(board::at(best), who);
+	}
+
+protected:
+	/**
+	 * the negamax score of who to move at b by a search of depth plies with the window (alpha, beta),
+	 * where ply is the distance from the root, whose best move is kept in root_move
+	 * the moves after the first are searched with a null window, and searched again if they fall
+	 * inside the window
+	 */
+	int search(const board& b, board::piece_type who, int depth, int alpha, int beta, unsigned ply) {
+		if ((++count % check_interval) == 0 && hclock::now() >= deadline) aborted = true;
+		if (aborted) return 0;
+		board::bitboard moves = b.legal_moves(who);
+		if (!moves) return -(win_score - int(ply));
+		if (depth == 0) return evaluate(b, who);
+
+		const uint64_t key = b.hash() | 1; // the key 0 is reserved for empty entries
+		entry* e = table.get() + (key & mask);
+		unsigned hint = none;
+		for (entry* k = e; k != e + 2; k++) {
+			if (k->key != key) continue;
+			hint = k->move;
+			int s = from_table(k->score, ply);
+			if (ply && k->depth >= depth && (k->bound == exact || (k->bound == lower && s >= beta) || (k->bound == upper && s <= alpha)))
+				return s;
+			e = k;
+			break;
+		}
+
+		std::array<std::pair<int, unsigned>, board::bits> order;
+		unsigned n = 0;
+		while (moves) {
+			unsigned m = moves.pop();
+			int priority = m == hint ? 1 << 30 : m == killers[ply][0] ? 1 << 29 : m == killers[ply][1] ? 1 << 28
+				: int(history[who - 1][m]);
+			order[n++] = std::make_pair(-priority, m);
+		}
+		std::sort(order.begin(), order.begin() + n);
+
+		const board::piece_type opp = who == board::black ? board::white : board::black;
+		const int window = alpha;
+		int best = -infinity;
+		unsigned best_move = order[0].second;
+		for (unsigned k = 0; k < n; k++) {
+			const unsigned m = order[k].second;
+			board after = b;
+			after.play_unchecked(board::at(m), who);
+			int s;
+			if (k == 0) {
+				s = -search(after, opp, depth - 1, -beta, -alpha, ply + 1);
+			} else {
+				s = -search(after, opp, depth - 1, -alpha - 1, -alpha, ply + 1);
+				if (s > alpha && s < beta) s = -search(after, opp, depth - 1, -beta, -alpha, ply + 1);
+			}
+			if (aborted) return 0;
+			if (s > best) best = s, best_move = m;
+			if (s > alpha) alpha = s;
+			if (alpha >= beta) {
+				if (killers[ply][0] != m) killers[ply][1] = killers[ply][0], killers[ply][0] = m;
+				history[who - 1][m] += depth * depth;
+				break;
+			}
+		}
+
+		// replace the entry of the same position, otherwise the one of a smaller depth
+		if (e->key != key && e[1].depth < e[0].depth) e++;
+		e->key = key;
+		e->score = to_table(best, ply);
+		e->depth = depth;
+		e->bound = best <= window ? upper : best >= beta ? lower : exact;
+		e->move = best_move;
+		if (ply == 0) root_move = best_move;
+		return best;
+	}
+
+	/**
+	 * the mobility of who to move at b: the legal moves of who minus those of the opponent,
+	 * where the moves that only one player can take, which the other cannot spoil, count twice
+	 */
+	static int evaluate(const board& b, board::piece_type who) {
+		const board::bitboard& mine = b.legal_moves(who), & theirs = b.legal_moves(who == board::black ? board::white : board::black);
+		return int(mine.count()) - int(theirs.count()) + int((mine & ~theirs).count()) - int((theirs & ~mine).count());
+	}
+
+	/**
+	 * the scores of wins and losses are stored relative to the position, i.e., by the plies from it
+	 */
+	static int to_table(int s, unsigned ply) {
+		return s >= win_score - int(board::bits) ? s + int(ply) : s <= -win_score + int(board::bits) ? s - int(ply) : s;
+	}
+	static int from_table(int s, unsigned ply) {
+		return s >= win_score - int(board::bits) ? s - int(ply) : s <= -win_score + int(board::bits) ? s + int(ply) : s;
+	}
+
+private:
+	board::piece_type who;
+	int max_depth = board::bits;
+	double move_time = 1;
+	// the time left of the game and the moves left in the period, given by set_time_left()
+	double time_left = 0;
+	int stones_left = 0;
+	bool verbose = false;
+
+	enum : unsigned { none = -1u, check_interval = 1024 };
+	enum { win_score = 10000, infinity = win_score + 1 };
+	enum bound_type : uint8_t { exact, lower, upper };
+	struct entry {
+		uint64_t key;
+		int16_t score;
+		uint8_t depth;
+		bound_type bound;
+		uint8_t move;
+	};
+	std::unique_ptr<entry[]> table;
+	uint64_t mask;
+
+	std::array<std::array<unsigned, 2>, board::bits + 1> killers;
+	std::array<std::array<uint32_t, board::bits>, 2> history = {};
+	unsigned root_move = none;
+	hclock::time_point deadline;
+	bool aborted = false;
+	uint64_t count = 0;
+};
@@ -0,0 +1,125 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * bitboard.h: Define the multi-word mask used by the bitboard backend of the board
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <cstdint>
+
+/**
+ * a set of (64 * words) board cells, stored as 64-bit words
+ * bit i of the set is bit (i % 64) of word (i / 64)
+ *
+ * only the operations needed by the board are provided, i.e., the bitwise
+ * logic, the shifts for moving a whole set toward its neighbors, and the
+ * iteration over the set bits; the loops over the words are unrolled by the
+ * compiler since the number of words is a template argument
+ */
+template<unsigned words>
+class basic_bitboard {
+public:
+	constexpr basic_bitboard() : w() {}
+	template<typename... word>
+	constexpr explicit basic_bitboard(uint64_t w0, word... wn) : w{w0, uint64_t(wn)...} {}
+	basic_bitboard(const basic_bitboard& b) = default;
+	basic_bitboard& operator =(const basic_bitboard& b) = default;
+
+	static basic_bitboard bit(unsigned i) { basic_bitboard b; b.w[i / 64] = 1ull << (i % 64); return b; }
+
+public:
+	basic_bitboard operator &(const basic_bitboard& b) const { return basic_bitboard(*this) &= b; }
+	basic_bitboard operator |(const basic_bitboard& b) const { return basic_bitboard(*this) |= b; }
+	basic_bitboard operator ^(const basic_bitboard& b) const { return basic_bitboard(*this) ^= b; }
+	basic_bitboard operator ~() const { basic_bitboard r; for (unsigned k = 0; k < words; k++) r.w[k] = ~w[k]; return r; }
+	basic_bitboard& operator &=(const basic_bitboard& b) { for (unsigned k = 0; k < words; k++) w[k] &= b.w[k]; return *this; }
+	basic_bitboard& operator |=(const basic_bitboard& b) { for (unsigned k = 0; k < words; k++) w[k] |= b.w[k]; return *this; }
+	basic_bitboard& operator ^=(const basic_bitboard& b) { for (unsigned k = 0; k < words; k++) w[k] ^= b.w[k]; return *this; }
+
+	/**
+	 * shift the whole set toward the higher (<<) or lower (>>) bits, where 0 < n < 64
+	 */
+	basic_bitboard operator <<(unsigned n) const {
+		basic_bitboard r;
+		r.w[0] = w[0] << n;
+		for (unsigned k = 1; k < words; k++) r.w[k] = (w[k] << n) | (w[k - 1] >> (64 - n));
+		return r;
+	}
+	basic_bitboard operator >>(unsigned n) const {
+		basic_bitboard r;
+		for (unsigned k = 0; k + 1 < words; k++) r.w[k] = (w[k] >> n) | (w[k + 1] << (64 - n));
+		r.w[words - 1] = w[words - 1] >> n;
+		return r;
+	}
+
+	bool operator ==(const basic_bitboard& b) const {
+		uint64_t diff = 0;
+		for (unsigned k = 0; k < words; k++) diff |= w[k] ^ b.w[k];
+		return !diff;
+	}
+	bool operator !=(const basic_bitboard& b) const { return !(*this == b); }
+	explicit operator bool() const {
+		uint64_t any = 0;
+		for (unsigned k = 0; k < words; k++) any |= w[k];
+		return any;
+	}
+
+public:
+	bool test(unsigned i) const { return (w[i / 64] >> (i % 64)) & 1; }
+	void set(unsigned i) { w[i / 64] |= 1ull << (i % 64); }
+	void reset(unsigned i) { w[i / 64] &= ~(1ull << (i % 64)); }
+	/**
+	 * test whether the set has at least two bits, which is cheaper than count() >= 2
+	 */
+	bool many() const {
+		bool one = false;
+		for (unsigned k = 0; k < words; k++) {
+			if (!w[k]) continue;
+			if (one || (w[k] & (w[k] - 1))) return true;
+			one = true;
+		}
+		return false;
+	}
+	unsigned count() const {
+		unsigned n = 0;
+		for (unsigned k = 0; k < words; k++) n += __builtin_popcountll(w[k]);
+		return n;
+	}
+
+	/**
+	 * the index of the lowest set bit, the set should not be empty
+	 */
+	unsigned lsb() const {
+		unsigned k = 0;
+		while (!w[k]) k++;
+		return k * 64 + __builtin_ctzll(w[k]);
+	}
+
+	/**
+	 * remove the lowest set bit from the set and return its index, the set should not be empty
+	 */
+	unsigned pop() {
+		unsigned k = 0;
+		while (!w[k]) k++;
+		unsigned i = k * 64 + __builtin_ctzll(w[k]);
+		w[k] &= w[k] - 1;
+		return i;
+	}
+
+	/**
+	 * the k-th 64-bit word of the set
+	 */
+	uint64_t word(unsigned k) const { return w[k]; }
+
+	/**
+	 * read the set from, or write it to, (words) consecutive 64-bit words
+	 */
+	static basic_bitboard load(const uint64_t* p) { basic_bitboard b; for (unsigned k = 0; k < words; k++) b.w[k] = p[k]; return b; }
+	void store(uint64_t* p) const { for (unsigned k = 0; k < words; k++) p[k] = w[k]; }
+
+private:
+	uint64_t w[words];
+};
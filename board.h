@@ -15,6 +15,113 @@
 #include <algorithm>
 #include <utility>
 #include <cmath>
+#include "bitboard.h"
+
+/**
+ * compile-time lists of indices, for building the constant tables of the board geometry
+ * the lists are built by halves so that the depth of instantiation stays logarithmic
+ */
+template<unsigned... i> struct index_list {};
+template<class front, class back> struct index_concat;
+template<unsigned... i, unsigned... j> struct index_concat<index_list<i...>, index_list<j...>> {
+	typedef index_list<i..., (sizeof...(i) + j)...> type;
+};
+template<unsigned n> struct make_index_list {
+	typedef typename index_concat<typename make_index_list<n / 2>::type,
+	                              typename make_index_list<n - n / 2>::type>::type type;
+};
+template<> struct make_index_list<0> { typedef index_list<> type; };
+template<> struct make_index_list<1> { typedef index_list<0> type; };
+
+/**
+ * a constant table evaluated at compile time, where value[i] == generator::at(i) for i < generator::length
+ */
+template<class generator, class list = typename make_index_list<generator::length>::type> struct constant_table;
+template<class generator, unsigned... i> struct constant_table<generator, index_list<i...>> {
+	typedef decltype(generator::at(0)) type;
+	static constexpr type value[sizeof...(i)] = { generator::at(i)... };
+};
+template<class generator, unsigned... i>
+constexpr typename constant_table<generator, index_list<i...>>::type constant_table<generator, index_list<i...>>::value[sizeof...(i)];
+
+/**
+ * the geometry of a (width x height) board, with a (hollow_width x hollow_height) hollow at the center
+ *
+ * the cells are laid out in 1-d with a border of sentinels, where [x][y] is the bit ((x + 1) * stride + (y + 1)):
+ * each column is preceded by a guard, and there is an extra column of guards at both sides,
+ * so that every cell of the board has its 4 neighbors at the constant offsets -stride, -1, +1, +stride,
+ * and shifting a bitboard by 1 or stride moves every stone to its neighbor without wrapping around
+ *
+ * all the tables, i.e., the playable cells, the neighbor offsets, the index conversions, the symmetries,
+ * and the zobrist keys, are evaluated at compile time for each geometry
+ */
+template<unsigned width, unsigned height, unsigned hollow_width, unsigned hollow_height>
+struct board_geometry {
+	enum size { stride = height + 1u, bits = (width + 2u) * stride, words = (bits + 63u) / 64u,
+		cells = width * height - hollow_width * hollow_height };
+	typedef basic_bitboard<words> bitboard;
+	typedef typename make_index_list<words>::type word_list;
+	static_assert(width == height, "the symmetries require a square board");
+	static_assert(bits <= 256, "the bits should be indexed by uint8_t");
+
+	static constexpr unsigned bit(int x, int y) { return (x + 1) * stride + (y + 1); }
+	static constexpr int x_of(unsigned b) { return int(b / stride) - 1; }
+	static constexpr int y_of(unsigned b) { return int(b % stride) - 1; }
+	static constexpr bool in_range(int x, int y) { return x >= 0 && x < int(width) && y >= 0 && y < int(height); }
+	static constexpr bool is_hollow(int x, int y) {
+		return x >= int(width - hollow_width) / 2 && x < int(width - hollow_width) / 2 + int(hollow_width)
+		    && y >= int(height - hollow_height) / 2 && y < int(height - hollow_height) / 2 + int(hollow_height);
+	}
+	static constexpr bool is_playable(int x, int y) { return in_range(x, y) && !is_hollow(x, y); }
+
+	/**
+	 * the k-th word of the mask of the cell [x][y] if it is playable
+	 */
+	static constexpr uint64_t cell_word(int x, int y, unsigned k) {
+		return is_playable(x, y) && bit(x, y) / 64 == k ? 1ull << (bit(x, y) % 64) : 0;
+	}
+	static constexpr uint64_t playable_word(unsigned k, unsigned b = 0) {
+		return b < 64 ? cell_word(x_of(64 * k + b), y_of(64 * k + b), k) | playable_word(k, b + 1) : 0;
+	}
+	template<unsigned... k> static constexpr bitboard playable_of(index_list<k...>) {
+		return bitboard(playable_word(k)...);
+	}
+
+	/**
+	 * the bit where [x][y] goes after transposing the board if (s & 4), then rotating it clockwise by (s & 3) times
+	 */
+	static constexpr unsigned rotate(unsigned r, int x, int y) {
+		return r == 0 ? bit(x, y) : r == 1 ? bit(y, (width - 1) - x) :
+		       r == 2 ? bit((width - 1) - x, (height - 1) - y) : bit((height - 1) - y, x);
+	}
+	static constexpr unsigned image(unsigned s, int x, int y) {
+		return !in_range(x, y) ? bit(x, y) : (s & 4) ? rotate(s & 3, y, x) : rotate(s & 3, x, y);
+	}
+
+	/**
+	 * the n-th output of splitmix64 with a fixed seed, so the hashes are reproducible
+	 */
+	static constexpr uint64_t splitmix(uint64_t z) { return z ^ (z >> 31); }
+	static constexpr uint64_t splitmix(uint64_t z, int round) {
+		return round == 0 ? splitmix((z ^ (z >> 27)) * 0x94d049bb133111ebull)
+		                  : splitmix((z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull, round - 1);
+	}
+	static constexpr uint64_t random(unsigned n) { return splitmix(0x9e3779b97f4a7c15ull * (n + 2), 1); }
+
+	struct playable_cells { enum { length = 1 }; static constexpr bitboard at(unsigned) { return playable_of(word_list()); } };
+	struct neighbor_offsets { enum { length = 4 }; static constexpr int at(unsigned d) { return d == 0 ? -int(stride) : d == 1 ? -1 : d == 2 ? 1 : int(stride); } };
+	struct index_bits { enum { length = width * height }; static constexpr uint8_t at(unsigned i) { return bit(i / height, i % height); } };
+	struct bit_indices { enum { length = bits }; static constexpr int16_t at(unsigned b) { return in_range(x_of(b), y_of(b)) ? x_of(b) * height + y_of(b) : -1; } };
+	struct symmetry_images { enum { length = 8 * bits }; static constexpr uint8_t at(unsigned i) { return image(i / bits, x_of(i % bits), y_of(i % bits)); } };
+	struct zobrist_keys { enum { length = 3 * bits }; static constexpr uint64_t at(unsigned i) { return random(i); } };
+
+	static const bitboard& playable() { return constant_table<playable_cells>::value[0]; }
+	static int offset(unsigned d) { return constant_table<neighbor_offsets>::value[d]; }
+	static unsigned bit_of(unsigned i) { return constant_table<index_bits>::value[i]; }
+	static int index_of(unsigned b) { return constant_table<bit_indices>::value[b]; }
+	static unsigned image(unsigned s, unsigned i) { return constant_table<symmetry_images>::value[s * bits + i]; }
+	static const uint64_t& zobrist(unsigned who, unsigned i) { return constant_table<zobrist_keys>::value[who * bits + i]; }
+};
 
 /**
  * definition for the 9x9 board
@@ -41,34 +148,67 @@
  *
  * for 9x9 Hollow NoGo, the center 3x3 is hollow (hollow but not empty, cannot be counted as liberty),
  * i.e., there are also borders at the center of the board
+ *
+ * the board is a template of its geometry, see board_geometry for the layout of the bitboards;
+ * the geometry used by the program is selected by BOARD_GEOMETRY at compile time, 9x9 Hollow by default
+ *
+ * internally the cells are stored in the 1-d layout with sentinels of board_geometry, where the guards and
+ * the hollow cells are all piece_type::hollow, so the neighbors of any cell can be visited without bounds checks;
+ * the 2-d array style accessors are views of this layout
+ *
+ * besides the cells, the stones of each side are also kept as a bitboard,
+ * the guards and the hollow cells are excluded by the constant mask of the playable cells
+ *
+ * the blocks (connected stones) are also tracked incrementally, indexed by the bit of their stones:
+ * the stones of a block form a circular list, and each stone refers to the slot of its block
+ * in a compact pool that holds the liberties of the whole block (see liberty_pool);
+ * since NoGo never captures, blocks only grow and merge
+ *
+ * the legal moves of both sides are kept as bitboards as well, and a placement only re-examines
+ * the liberties of the blocks around it, since the legality of any other empty cell cannot change
+ *
+ * a 64-bit zobrist hash of the stones and the side to move is also maintained by each placement,
+ * together with the hashes of the first (symmetries - 1) other symmetric boards; the board used by
+ * the search keeps only its own hash, while symmetric_board keeps all 8 hashes for merging the
+ * symmetric positions, so that its canonical form is found without visiting the stones
  */
-class board {
+template<unsigned width, unsigned height, unsigned hollow_width, unsigned hollow_height, unsigned symmetries = 1>
+class basic_board {
 public:
-	enum size { size_x = 9u, size_y = 9u, hollow_x = 3u, hollow_y = 3u };
+	typedef board_geometry<width, height, hollow_width, hollow_height> geometry;
+	typedef typename geometry::bitboard bitboard;
+	enum size { size_x = width, size_y = height, hollow_x = hollow_width, hollow_y = hollow_height,
+		stride = geometry::stride, bits = geometry::bits };
 	enum piece_type { empty = 0u, black = 1u, white = 2u, hollow = 3u, unknown = -1u };
 	typedef uint32_t cell;
 	typedef std::array<cell, size_y> column;
 	typedef std::array<column, size_x> grid;
+	typedef std::array<cell, bits> padded_grid;
 	struct data {
 		piece_type who_take_turns;
 	};
 	typedef int reward;
 
 public:
-	board() : stone(initial()), attr({piece_type::black}) {}
-	board(const grid& b, const data& d) : stone(b), attr(d) {}
-	board(const board& b) = default;
-	board& operator =(const board& b) = default;
+	basic_board() : stone(initial()), attr({piece_type::black}), next(), group(), key() { sync(); }
+	basic_board(const grid& b, const data& d) : stone(initial()), attr(d), next(), group(), key() {
+		for (int x = 0; x < size_x; x++)
+			for (int y = 0; y < size_y; y++)
+				stone[bit(x, y)] = b[x][y];
+		sync();
+	}
+	basic_board(const basic_board& b) = default;
+	basic_board& operator =(const basic_board& b) = default;
 
 	struct point {
 		int x, y, i;
-		point(int i = -1) : x(i != -1 ? i / size_y : -1), y(i != -1 ? i % size_y : -1), i(i) {}
-		point(int x, int y) : x(x), y(y), i(x != -1 && y != -1 ? x * size_y + y : -1) {}
+		constexpr point(int i = -1) : x(i != -1 ? i / size_y : -1), y(i != -1 ? i % size_y : -1), i(i) {}
+		constexpr point(int x, int y) : x(x), y(y), i(x != -1 && y != -1 ? x * size_y + y : -1) {}
 		point(const std::string& name) : point(
 			name.size() >= 2 && name != "PASS" ? name[0] - (name[0] > 'I' ? 'B' : 'A') : -1,
 			name.size() >= 2 && std::isdigit(name[1]) ? std::stoul(name.substr(1)) - 1 : -1) {}
 		point(const char* name) : point(std::string(name)) {}
-		point(const point&) = default;
+		constexpr point(const point&) = default;
 		operator std::string() const {
 			if (i == -1) return "PASS";
 			if (x >= size_x || y >= size_y) return "??";
@@ -76,25 +216,55 @@ public:
 		}
 	};
 
-	operator grid&() { return stone; }
-	operator const grid&() const { return stone; }
-	column& operator [](unsigned x) { return stone[x]; }
-	const column& operator [](unsigned x) const { return stone[x]; }
-	cell& operator ()(unsigned i) { point p(i); return stone[p.x][p.y]; }
-	const cell& operator ()(unsigned i) const { point p(i); return stone[p.x][p.y]; }
-	cell& operator ()(const std::string& move) { point p(move); return stone[p.x][p.y]; }
-	const cell& operator ()(const std::string& move) const { point p(move); return stone[p.x][p.y]; }
+	/**
+	 * a view of the column x in the 1-d layout, where [y] is the cell [x][y]
+	 */
+	template<class grid_type> class column_view {
+	public:
+		column_view(grid_type& stone, unsigned x) : stone(stone), x(x) {}
+		auto operator [](unsigned y) const -> decltype(std::declval<grid_type&>()[0]) { return stone[bit(x, y)]; }
+	private:
+		grid_type& stone;
+		unsigned x;
+	};
+
+	// note that the bitboards are not updated by writing the cells directly, call sync() after that
+	operator grid() const { return get_stone(); }
+	column_view<padded_grid> operator [](unsigned x) { return column_view<padded_grid>(stone, x); }
+	column_view<const padded_grid> operator [](unsigned x) const { return column_view<const padded_grid>(stone, x); }
+	cell& operator ()(unsigned i) { return stone[geometry::bit_of(i)]; }
+	const cell& operator ()(unsigned i) const { return stone[geometry::bit_of(i)]; }
+	cell& operator ()(const std::string& move) { point p(move); return stone[bit(p.x, p.y)]; }
+	const cell& operator ()(const std::string& move) const { point p(move); return stone[bit(p.x, p.y)]; }
 
 	data info() const { return attr; }
-	data info(data dat) { data old = attr; attr = dat; return old; }
+	data info(data dat) {
+		data old = attr;
+		attr = dat;
+		for (uint64_t& k : key) k ^= turn(old) ^ turn(dat);
+		return old;
+	}
+
+	/**
+	 * the zobrist hash of the stones and the side to move, after applying the given symmetry
+	 * the hashes that are not maintained (s >= symmetries) are computed from the stones
+	 */
+	uint64_t hash(unsigned s = symmetry::identity) const {
+		if (s < symmetries) return key[s];
+		uint64_t h = turn(attr);
+		for (unsigned who = piece_type::black; who <= piece_type::white; who++) {
+			for (bitboard b = mask[who - 1]; b; ) h ^= zobrist(who, image(s, b.pop()));
+		}
+		return h;
+	}
 
 public:
-	bool operator ==(const board& b) const { return stone == b.stone; }
-	bool operator < (const board& b) const { return stone <  b.stone; }
-	bool operator !=(const board& b) const { return !(*this == b); }
-	bool operator > (const board& b) const { return b < *this; }
-	bool operator <=(const board& b) const { return !(b < *this); }
-	bool operator >=(const board& b) const { return !(*this < b); }
+	bool operator ==(const basic_board& b) const { return stone == b.stone; }
+	bool operator < (const basic_board& b) const { return stone <  b.stone; }
+	bool operator !=(const basic_board& b) const { return !(*this == b); }
+	bool operator > (const basic_board& b) const { return b < *this; }
+	bool operator <=(const basic_board& b) const { return !(b < *this); }
+	bool operator >=(const basic_board& b) const { return !(*this < b); }
 
 public:
 	enum nogo_move_result {
@@ -113,27 +283,50 @@ public:
 	 * return nogo_move_result::legal if the action is valid, or nogo_move_result::illegal_* if not
 	 */
 	reward place(int x, int y, unsigned who = piece_type::unknown) {
+		if (who == -1u) who = attr.who_take_turns;
+		reward result = is_legal(x, y, who);
+		if (result == nogo_move_result::legal) play_unchecked(x, y, who); // is legal move!
+		return result;
+	}
+	reward place(const point& p, unsigned who = piece_type::unknown) {
+		return place(p.x, p.y, who);
+	}
+
+	/**
+	 * check whether a stone can be placed to the specific position, without modifying the board
+	 * who == piece_type::unknown indicates automatically play as the next side
+	 * return the same nogo_move_result as place
+	 */
+	reward is_legal(int x, int y, unsigned who = piece_type::unknown) const {
 		if (who == -1u) who = attr.who_take_turns;
 		if (who != attr.who_take_turns) return nogo_move_result::illegal_turn;
 		if (x == -1 && y == -1) return nogo_move_result::illegal_pass;
 		point p_min(0, 0), p_max(size_x - 1, size_y - 1);
 		if (x < p_min.x || x > p_max.x || y < p_min.y || y > p_max.y) return nogo_move_result::illegal_out_of_range;
-		if (board::initial()[x][y] == piece_type::hollow)             return nogo_move_result::illegal_out_of_range;
-		board test = *this;
-		if (test[x][y] != piece_type::empty) return nogo_move_result::illegal_not_empty;
-		test[x][y] = who; // try put a piece first
-		if (test.check_liberty(x, y, who) == 0) return nogo_move_result::illegal_suicide;
-		unsigned opp = 3u - who;
-		if (x > p_min.x && test.check_liberty(x - 1, y, opp) == 0) return nogo_move_result::illegal_take;
-		if (x < p_max.x && test.check_liberty(x + 1, y, opp) == 0) return nogo_move_result::illegal_take;
-		if (y > p_min.y && test.check_liberty(x, y - 1, opp) == 0) return nogo_move_result::illegal_take;
-		if (y < p_max.y && test.check_liberty(x, y + 1, opp) == 0) return nogo_move_result::illegal_take;
-		stone[x][y] = who; // is legal move!
-		attr.who_take_turns = static_cast<piece_type>(opp);
-		return nogo_move_result::legal;
+		if (geometry::is_hollow(x, y))                                 return nogo_move_result::illegal_out_of_range;
+		unsigned i = bit(x, y);
+		if (stone[i] != piece_type::empty) return nogo_move_result::illegal_not_empty;
+		return moves[who - 1].test(i) ? reward(nogo_move_result::legal) : judge(i, who);
 	}
-	reward place(const point& p, unsigned who = piece_type::unknown) {
-		return place(p.x, p.y, who);
+	reward is_legal(const point& p, unsigned who = piece_type::unknown) const {
+		return is_legal(p.x, p.y, who);
+	}
+
+	/**
+	 * place a stone that is already known to be legal (e.g., a move of an expanded search tree)
+	 * the move is NOT checked at all, so an illegal move here corrupts the board
+	 */
+	void play_unchecked(int x, int y, unsigned who = piece_type::unknown) {
+		if (who == -1u) who = attr.who_take_turns;
+		unsigned i = bit(x, y);
+		stone[i] = who;
+		link(i, who);
+		const uint64_t side = turn(attr);
+		attr.who_take_turns = static_cast<piece_type>(3u - who);
+		for (unsigned s = 0; s < symmetries; s++) key[s] ^= zobrist(who, image(s, i)) ^ side ^ turn(attr);
+	}
+	void play_unchecked(const point& p, unsigned who = piece_type::unknown) {
+		play_unchecked(p.x, p.y, who);
 	}
 
 	/**
@@ -141,84 +334,229 @@ public:
 	 * return >= 0 if [x][y] is placed by who; otherwise return -1
 	 */
 	int check_liberty(int x, int y, unsigned who) const {
-		grid test = stone;
-		if (test[x][y] != who) return -1;
+		unsigned i = bit(x, y);
+		if (stone[i] != who) return -1;
+		return libs[group[i]].count();
+	}
 
-		int liberty = 0;
-		std::list<point> check;
-		for (check.emplace_back(x, y); check.size(); check.pop_front()) {
-			int x = check.front().x, y = check.front().y;
-			test[x][y] = piece_type::unknown; // prevent recalculate
+	/**
+	 * the legal moves of who as a bitboard, where who is either piece_type::black or piece_type::white
+	 * note that the legality here does not care whose turn it is
+	 */
+	const bitboard& legal_moves(unsigned who) const { return moves[who - 1]; }
+	unsigned legal_count(unsigned who) const { return moves[who - 1].count(); }
 
-			point p_min(0, 0), p_max(size_x - 1, size_y - 1);
+	/**
+	 * the mobility gain of who playing at the empty bit i, i.e., the legal moves the opponent loses
+	 * minus the legal moves who loses, evaluated without modifying the board
+	 *
+	 * only the liberties of the blocks around i may change their legality (see link), so the cells
+	 * are judged again as in judge, with the liberties that these blocks have after the move
+	 */
+	int mobility(unsigned i, unsigned who) const {
+		const unsigned opp = 3 - who;
+		const bitboard put = bitboard::bit(i);
+		bitboard lib, area; // liberties of the merged block of i, and of the opponent's blocks around
+		for (unsigned d = 0; d < 4; d++) {
+			unsigned n = i + geometry::offset(d);
+			cell near = stone[n];
+			if (near == piece_type::empty) lib.set(n);
+			else if (near == who)          lib |= libs[group[n]];
+			else if (near == opp)          area |= libs[group[n]];
+		}
+		lib.reset(i);
+		area.reset(i);
+		auto legal = [&](unsigned c, unsigned p) -> bool {
+			const bitboard at = bitboard::bit(c);
+			bool alive = false, take = false;
+			for (unsigned d = 0; d < 4; d++) {
+				unsigned n = c + geometry::offset(d);
+				unsigned near = n == i ? who : unsigned(stone[n]);
+				if (near == piece_type::empty) { alive = true; continue; }
+				if (near != piece_type::black && near != piece_type::white) continue;
+				// a block touching i is merged into i (own) or loses i (opponent's)
+				bitboard after = lib;
+				if (n != i) {
+					const bitboard before = libs[group[n]];
+					if (near != who || !before.test(i)) after = before & ~put;
+				}
+				if (near == p) alive |= after != at;
+				else           take |= after == at;
+			}
+			return alive && !take;
+		};
+		int gain = int(moves[opp - 1].test(i)) - int(moves[who - 1].test(i));
+		for (bitboard a = lib | area; a; ) {
+			unsigned c = a.pop();
+			gain += int(moves[opp - 1].test(c)) - int(legal(c, opp));
+			gain -= int(moves[who - 1].test(c)) - int(legal(c, who));
+		}
+		return gain;
+	}
 
-			cell near_l = x > p_min.x ? test[x - 1][y] : -1u; // left
-			if (near_l == piece_type::empty) liberty++;
-			else if (near_l == who) check.emplace_back(x - 1, y);
+	/**
+	 * evaluate the legal moves of who on all the empty cells in one pass, from the stones and the blocks,
+	 * which gives the same result as legal_moves(who) but without relying on the maintained sets
+	 *
+	 * an empty cell is legal if it touches another empty cell or an own block with another liberty,
+	 * and it is not the only liberty of an opponent's block; the blocks are visited through the slots
+	 * of the liberty pool, so the liberties of each block are visited once
+	 */
+	bitboard legal_mask(unsigned who) const {
+		bitboard space = empties(), alive = neighbor(space), taken;
+		for (unsigned s = 0; s < libs.size(); s++) {
+			const bitboard lib = libs[s];
+			if (stone[libs.owner(s)] == who) {
+				if (lib.many()) alive |= lib;
+			} else {
+				if (!lib.many()) taken |= lib;
+			}
+		}
+		return space & alive & ~taken;
+	}
 
-			cell near_r = x < p_max.x ? test[x + 1][y] : -1u; // right
-			if (near_r == piece_type::empty) liberty++;
-			else if (near_r == who) check.emplace_back(x + 1, y);
+	/**
+	 * the bit index of [x][y] in the bitboards and the 1-d layout
+	 */
+	static constexpr unsigned bit(int x, int y) { return geometry::bit(x, y); }
 
-			cell near_d = y > p_min.y ? test[x][y - 1] : -1u; // down
-			if (near_d == piece_type::empty) liberty++;
-			else if (near_d == who) check.emplace_back(x, y - 1);
+	/**
+	 * the point at the bit b, through the precomputed table without division
+	 */
+	static point at(unsigned b) { return point(geometry::index_of(b)); }
 
-			cell near_u = y < p_max.y ? test[x][y + 1] : -1u; // up
-			if (near_u == piece_type::empty) liberty++;
-			else if (near_u == who) check.emplace_back(x, y + 1);
-		}
-		return liberty;
+	/**
+	 * the stones of who as a bitboard, where who is either piece_type::black or piece_type::white
+	 */
+	const bitboard& stones(unsigned who) const { return mask[who - 1]; }
+
+	/**
+	 * the empty cells as a bitboard
+	 */
+	bitboard empties() const { return playable() & ~(mask[0] | mask[1]); }
+
+	/**
+	 * the constant mask of the cells that can hold a stone, i.e., excluding the hollow and the guards
+	 */
+	static const bitboard& playable() { return geometry::playable(); }
+
+	/**
+	 * the cells adjacent to any cell of the given mask (the result may contain unplayable cells)
+	 */
+	static bitboard neighbor(const bitboard& b) {
+		return (b << 1) | (b >> 1) | (b << stride) | (b >> stride);
 	}
 
-	void transpose() {
-		for (int x = 0; x < size_x; x++) {
-			for (int y = x + 1; y < size_y; y++) {
-				std::swap(stone[x][y], stone[y][x]);
-			}
-		}
+	/**
+	 * the block (connected stones) of the given color mask that contains the seed
+	 */
+	static bitboard block(const bitboard& seed, const bitboard& color) {
+		bitboard blk = seed, last;
+		do {
+			last = blk;
+			blk |= neighbor(blk) & color;
+		} while (blk != last);
+		return blk;
 	}
 
-	void reflect_horizontal() {
-		for (int y = 0; y < size_y; y++) {
-			for (int x = 0; x < size_x / 2; x++) {
-				std::swap(stone[x][y], stone[size_x - 1 - x][y]);
+	/**
+	 * the random keys of the zobrist hash for a stone of who at the bit i, where who = 0 is the key of white to move
+	 */
+	static const uint64_t& zobrist(unsigned who, unsigned i = 0) { return geometry::zobrist(who, i); }
+
+	/**
+	 * the bit where the bit i goes after applying symmetry s
+	 */
+	static unsigned image(unsigned s, unsigned i) { return s != symmetry::identity ? geometry::image(s, i) : i; }
+
+	/**
+	 * rebuild the bitboards, the blocks, the legal moves, and the hash from the 2-d array
+	 * should be called after the stones are modified directly through the grid accessors
+	 */
+	void sync() {
+		mask[0] = mask[1] = bitboard();
+		libs.clear();
+		for (uint64_t& k : key) k = turn(attr);
+		for (unsigned i = 0; i < bits; i++) {
+			cell who = stone[i];
+			if (who != piece_type::black && who != piece_type::white) continue;
+			mask[who - 1].set(i);
+			for (unsigned s = 0; s < symmetries; s++) key[s] ^= zobrist(who, image(s, i));
+		}
+		bitboard space = empties();
+		for (const bitboard& color : mask) {
+			for (bitboard rest = color; rest; ) {
+				unsigned h = rest.lsb(), last = h;
+				bitboard blk = block(bitboard::bit(h), color);
+				rest &= ~blk;
+				unsigned slot = libs.insert(h, neighbor(blk) & space);
+				for (bitboard s = blk; s; last = next[last]) {
+					unsigned i = s.pop();
+					group[i] = slot;
+					next[last] = i;
+				}
+				next[last] = h;
 			}
 		}
+		moves[0] = legal_mask(piece_type::black);
+		moves[1] = legal_mask(piece_type::white);
 	}
 
-	void reflect_vertical() {
-		for (int x = 0; x < size_x; x++) {
-			for (int y = 0; y < size_y / 2; y++) {
-				std::swap(stone[x][y], stone[x][size_y - 1 - y]);
-			}
-		}
+	/**
+	 * the 8 symmetries of the board, where symmetry s transposes the board if (s & 4),
+	 * then rotates it clockwise by (s & 3) times
+	 */
+	enum symmetry { identity = 0, rotated_right = 1, reversed = 2, rotated_left = 3,
+		transposed = 4, flipped_vertical = 5, anti_transposed = 6, flipped_horizontal = 7 };
+
+	/**
+	 * apply symmetry s to the board, moving each cell along the precomputed permutation table
+	 */
+	void transform(unsigned s) {
+		padded_grid before = stone;
+		for (unsigned i = 0; i < bits; i++) stone[image(s, i)] = before[i];
+		sync();
 	}
 
 	/**
-	 * rotate the board clockwise by given times
+	 * the canonical form among the 8 symmetries, which is the one with the minimal hash
+	 * return the hash of the canonical form, and the symmetry s such that transform(s) gives the canonical form
+	 * this only compares the maintained hashes on a symmetric_board, and visits the stones otherwise
 	 */
-	void rotate(int r = 1) {
-		switch (((r % 4) + 4) % 4) {
-		default:
-		case 0: break;
-		case 1: rotate_right(); break;
-		case 2: reverse(); break;
-		case 3: rotate_left(); break;
+	std::pair<uint64_t, unsigned> canonical() const {
+		unsigned s = 0;
+		uint64_t min = key[0];
+		for (unsigned t = 1; t < 8; t++) {
+			uint64_t h = hash(t);
+			if (h < min) min = h, s = t;
 		}
+		return std::make_pair(min, s);
 	}
 
-	void rotate_right() { transpose(); reflect_vertical(); } // clockwise
-	void rotate_left() { transpose(); reflect_horizontal(); } // counterclockwise
-	void reverse() { reflect_horizontal(); reflect_vertical(); }
+	void transpose() { transform(symmetry::transposed); }
+	void reflect_horizontal() { transform(symmetry::flipped_horizontal); }
+	void reflect_vertical() { transform(symmetry::flipped_vertical); }
+
+	/**
+	 * rotate the board clockwise by given times
+	 */
+	void rotate(int r = 1) { transform(((r % 4) + 4) % 4); }
+
+	void rotate_right() { transform(symmetry::rotated_right); } // clockwise
+	void rotate_left() { transform(symmetry::rotated_left); } // counterclockwise
+	void reverse() { transform(symmetry::reversed); }
 
 	//get stone -test 1128
-	grid get_stone(){
-		return stone;
+	grid get_stone() const {
+		grid g;
+		for (int x = 0; x < size_x; x++)
+			for (int y = 0; y < size_y; y++)
+				g[x][y] = stone[bit(x, y)];
+		return g;
 	}
 
 public:
-	friend std::ostream& operator <<(std::ostream& out, const board& b) {
+	friend std::ostream& operator <<(std::ostream& out, const basic_board& b) {
 		std::ios ff(nullptr);
 		ff.copyfmt(out); // make a copy of the original print format
 
@@ -247,7 +585,7 @@ public:
 		out.copyfmt(ff); // restore print format
 		return out;
 	}
-	friend std::istream& operator >>(std::istream& in, board& b) {
+	friend std::istream& operator >>(std::istream& in, basic_board& b) {
 		std::string token;
 		for (int x = 0; x < size_x; x++) in >> token; /* skip X */
 		for (int y = size_y - 1; y >= 0 && in >> token /* skip Y */; in >> token /* skip Y */, y--) {
@@ -266,6 +604,7 @@ public:
 			}
 		}
 		for (int x = 0; x < size_x; x++) in >> token; /* skip X */
+		b.sync();
 		return in;
 	}
 	friend std::ostream& operator <<(std::ostream& out, const point& p) {
@@ -278,15 +617,178 @@ public:
 	}
 
 protected:
-	static const grid& initial() { static grid stone; return stone; }
-	static __attribute__((constructor)) void init_initial_scheme() {
-		grid& stone = const_cast<grid&>(initial());
-		point hollow((size_x - hollow_x) / 2, (size_y - hollow_y) / 2);
-		for (int x = hollow.x; x < hollow.x + hollow_x; x++)
-			for (int y = hollow.y; y < hollow.y + hollow_y; y++)
-				stone[x][y] = piece_type::hollow;
+	static const padded_grid& initial() { static const padded_grid stone = initial_scheme(); return stone; }
+	static padded_grid initial_scheme() {
+		padded_grid stone;
+		for (unsigned i = 0; i < bits; i++)
+			stone[i] = playable().test(i) ? piece_type::empty : piece_type::hollow; // guards are also hollow
+		return stone;
 	}
+
+	static uint64_t turn(const data& dat) { return dat.who_take_turns == piece_type::white ? zobrist(0) : 0; }
+
+	/**
+	 * judge whether who can put a stone at the empty bit i
+	 * return nogo_move_result::legal, nogo_move_result::illegal_suicide, or nogo_move_result::illegal_take
+	 */
+	reward judge(unsigned i, unsigned who) const {
+		bitboard put = bitboard::bit(i);
+		bool alive = false, take = false;
+		for (unsigned d = 0; d < 4; d++) {
+			unsigned n = i + geometry::offset(d);
+			cell near = stone[n];
+			if (near == piece_type::empty) alive = true;
+			else if (near == who)                alive |= libs[group[n]] != put; // the block has a liberty other than i
+			else if (near != piece_type::hollow) take |= libs[group[n]] == put;
+		}
+		if (!alive) return nogo_move_result::illegal_suicide;
+		if (take) return nogo_move_result::illegal_take;
+		return nogo_move_result::legal;
+	}
+
+	/**
+	 * re-examine the legality of the given empty cells for both sides
+	 */
+	void refresh(bitboard area) {
+		while (area) {
+			unsigned i = area.pop();
+			for (unsigned who = piece_type::black; who <= piece_type::white; who++) {
+				if (judge(i, who) == nogo_move_result::legal) moves[who - 1].set(i);
+				else                                          moves[who - 1].reset(i);
+			}
+		}
+	}
+
+	/**
+	 * add the stone at the bit i to the blocks, and update the legal moves around it
+	 */
+	void link(unsigned i, unsigned who) {
+		bitboard lib, area; // liberties of the merged block, and the liberties of the opponent's blocks around
+		mask[who - 1].set(i);
+		next[i] = i;
+		group[i] = liberty_pool::none;
+		for (unsigned d = 0; d < 4; d++) {
+			unsigned n = i + geometry::offset(d);
+			cell near = stone[n];
+			if (near == piece_type::empty) {
+				lib.set(n);
+			} else if (near == who) {
+				unsigned g = group[n], r = group[i];
+				if (g == r) continue;
+				lib |= libs[g];
+				if (r == liberty_pool::none) { // the stone joins the block of n
+					group[i] = g;
+					std::swap(next[i], next[n]);
+				} else {
+					merge(r, i, g, n);
+				}
+			} else if (near != piece_type::hollow) {
+				bitboard opp = libs[group[n]];
+				opp.reset(i);
+				libs.assign(group[n], opp);
+				area |= opp;
+			}
+		}
+		lib.reset(i);
+		if (group[i] == liberty_pool::none) group[i] = libs.insert(i, lib);
+		else                                libs.assign(group[i], lib);
+		moves[0].reset(i);
+		moves[1].reset(i);
+		refresh(lib | area);
+	}
+
+	/**
+	 * merge the block in the slot from, which has the stone j, into the block in the slot to, which has the stone i
+	 * the slot from is then filled by the last slot of the pool, whose stones are moved along
+	 */
+	void merge(unsigned to, unsigned i, unsigned from, unsigned j) {
+		relabel(j, to);
+		std::swap(next[i], next[j]);
+		unsigned moved = libs.erase(from);
+		if (moved != liberty_pool::none) relabel(moved, from);
+	}
+
+	/**
+	 * refer the stones of the block that has the stone i to the slot s
+	 */
+	void relabel(unsigned i, unsigned s) {
+		unsigned k = i;
+		do {
+			group[k] = s;
+			k = next[k];
+		} while (k != i);
+	}
+
+	/**
+	 * the liberties of the blocks, stored in a pool of slots so that a copy of the board
+	 * only copies the slots of the blocks on the board
+	 *
+	 * the slots in use are always the first ones, when a block is merged away,
+	 * its slot is filled by the last one
+	 */
+	class liberty_pool {
+	public:
+		enum { none = 0xffu };
+		liberty_pool() : used(0) {}
+		liberty_pool(const liberty_pool& p) : used(p.used) { copy(p); }
+		liberty_pool& operator =(const liberty_pool& p) { used = p.used; copy(p); return *this; }
+
+		bitboard operator [](unsigned s) const { return bitboard::load(word + s * geometry::words); }
+		void assign(unsigned s, const bitboard& lib) { lib.store(word + s * geometry::words); }
+
+		/**
+		 * the number of slots in use, and a stone of the block in the slot s
+		 */
+		unsigned size() const { return used; }
+		unsigned owner(unsigned s) const { return stone[s]; }
+
+		/**
+		 * add a block that has the stone i, return its slot
+		 */
+		unsigned insert(unsigned i, const bitboard& lib) {
+			stone[used] = i;
+			assign(used, lib);
+			return used++;
+		}
+
+		/**
+		 * remove the block in the slot s by moving the last slot into it
+		 * return a stone of the block moved into s, or none if s was the last slot
+		 */
+		unsigned erase(unsigned s) {
+			unsigned last = --used;
+			if (s == last) return none;
+			stone[s] = stone[last];
+			assign(s, (*this)[last]);
+			return stone[s];
+		}
+		void clear() { used = 0; }
+
+	private:
+		void copy(const liberty_pool& p) {
+			std::copy(p.stone, p.stone + used, stone);
+			std::copy(p.word, p.word + used * geometry::words, word);
+		}
+
+		unsigned used; // the number of slots in use
+		uint8_t stone[geometry::cells]; // a stone of the block in the slot
+		uint64_t word[geometry::cells * geometry::words]; // liberties of the block in the slot
+	};
+
 private:
-	grid stone;
+	padded_grid stone;
 	data attr;
-};
\ No newline at end of file
+	bitboard mask[2]; // stones of black and white
+	std::array<uint8_t, bits> next; // next stone of the same block
+	std::array<uint8_t, bits> group; // slot of the block in the liberty pool
+	liberty_pool libs; // liberties of the blocks
+	bitboard moves[2]; // legal moves of black and white
+	uint64_t key[symmetries]; // zobrist hashes of the board under the first symmetries
+	static_assert(symmetries >= 1 && symmetries <= 8, "the hash of the board itself is always maintained");
+};
+
+#ifndef BOARD_GEOMETRY
+#define BOARD_GEOMETRY 9, 9, 3, 3 // width, height, hollow width, hollow height
+#endif
+typedef basic_board<BOARD_GEOMETRY> board;
+typedef basic_board<BOARD_GEOMETRY, 8> symmetric_board; // for the transpositions and the openings merged by symmetry
\ No newline at end of file
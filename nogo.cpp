@@ -10,6 +10,7 @@
 #include <iostream>
 #include <fstream>
 #include <iterator>
+#include <cstring>
 #include <string>
 #include "board.h"
 #include "action.h"
@@ -17,6 +18,30 @@
 #include "episode.h"
 #include "statistic.h"
 
+/**
+ * the agent of the player arguments: the alpha-beta player for search=alpha-beta,
+ * otherwise the MCTS player, which also plays randomly for search=random
+ */
+agent* make_agent(const std::string& args) {
+	bool alpha_beta = false;
+	std::stringstream ss(args);
+	for (std::string pair; ss >> pair; ) {
+		if (pair.find("search=") == 0) alpha_beta = pair == "search=alpha-beta";
+	}
+	if (alpha_beta) return new alpha_beta_agent(args);
+	return new MCTSAgent(args);
+}
+
+/**
+ * parse the whole text as a non-negative number of a GTP argument
+ * return false if the text is not such a number, in which case value is unspecified
+ */
+template<typename number>
+bool parse(const std::string& text, number& value) {
+	std::istringstream in(text);
+	return (in >> value) && (in >> std::ws).eof() && value >= 0;
+}
+
 int main(int argc, const char* argv[]) {
 	std::cout << "HollowNoGo-Demo: ";
 	std::copy(argv, argv + argc, std::ostream_iterator<const char*>(std::cout, " "));
@@ -65,8 +90,10 @@ int main(int argc, const char* argv[]) {
 
 	//player black("name=black " + black_args + " role=black");
 	//player white("name=white " + white_args + " role=white");
-	MCTSAgent black("name=black " + black_args + " role=black");
-	MCTSAgent white("name=white " + white_args + " role=white");
+	std::unique_ptr<agent> black_agent(make_agent("name=black " + black_args + " role=black"));
+	std::unique_ptr<agent> white_agent(make_agent("name=white " + white_args + " role=white"));
+	agent& black = *black_agent;
+	agent& white = *white_agent;
 
 
 	if (!shell) { // launch standard local games
@@ -90,10 +117,17 @@ int main(int argc, const char* argv[]) {
 			white.close_episode(win.name());
 		}
 	} else { // launch GTP shell
+		agent* analyzing = nullptr; // the agent streaming the analysis, until the next command
 		for (std::string command; std::getline(std::cin, command); ) {
 			if (command.back() == '\r') command.pop_back();
 			if (command.empty()) continue;
 
+			if (analyzing) { // stop the analysis and end its response
+				analyzing->end_analysis();
+				analyzing = nullptr;
+				std::cout << std::endl;
+			}
+
 			std::vector<std::string> args;
 			std::istringstream iss(command);
 			for (std::string s; getline(iss, s, ' '); args.push_back(s));
@@ -164,11 +198,78 @@ int main(int argc, const char* argv[]) {
 				reply.pop_back(); // remove a new line
 
 			} else if (args[0] == "boardsize") { // set the board size
-				size_t size = std::stoul(args[1]);
-				if (size != board::size_x || size != board::size_y) {
+				int size = 0;
+				if (args.size() != 2 || !parse(args[1], size)) {
+					std::cout << "? " << "syntax error" << std::endl << std::endl;
+					continue;
+				}
+				if (size != board::size_x || size != board::size_y) { // the geometry is fixed at compile time
 					std::cerr << "board size mismatch: " << args[1] << std::endl;
+					std::cout << "? " << "unacceptable size" << std::endl << std::endl;
+					continue;
+				}
+
+			} else if (args[0] == "time_settings" || args[0] == "kgs-time_settings") { // set the clock
+				// time_settings main_time byo_yomi_time byo_yomi_stones, or
+				// kgs-time_settings none | absolute main_time | byoyomi main_time period_time periods
+				//                   | canadian main_time byo_yomi_time byo_yomi_stones
+				std::vector<std::string> clock(args.begin() + 1, args.end());
+				if (args[0] == "kgs-time_settings" && clock.size()) {
+					std::string type = clock[0];
+					clock.erase(clock.begin());
+					if (type == "none") clock = { "0", "0", "0" };
+					else if (type == "absolute" && clock.size() == 1) clock = { clock[0], "0", "0" };
+					else if (type == "byoyomi" && clock.size() == 3) clock = { clock[0], clock[1], "1" }; // a move per period
+					else if (type != "canadian") clock.clear();
+				}
+				double main_time, byo_yomi_time;
+				int byo_yomi_stones;
+				if (clock.size() != 3 || !parse(clock[0], main_time) || !parse(clock[1], byo_yomi_time)
+						|| !parse(clock[2], byo_yomi_stones)) {
+					std::cout << "? " << "syntax error" << std::endl << std::endl;
+					continue;
+				}
+				black.set_time(main_time, byo_yomi_time, byo_yomi_stones);
+				white.set_time(main_time, byo_yomi_time, byo_yomi_stones);
+
+			} else if (args[0] == "time_left") { // time_left color time stones
+				double time;
+				int stones;
+				if (args.size() != 4 || args[1].empty() || !std::strchr("bw", std::tolower(args[1][0]))
+						|| !parse(args[2], time) || !parse(args[3], stones)) {
+					std::cout << "? " << "syntax error" << std::endl << std::endl;
+					continue;
+				}
+				agent& who = std::tolower(args[1][0]) == 'b' ? black : white;
+				who.set_time_left(time, stones);
+
+			} else if (args[0] == "analyze") { // analyze [color] [interval in centiseconds]
+				if (!stat.is_episode_ongoing()) { // should open an episode
+					black.open_episode("~:" + white.name());
+					white.open_episode(black.name() + ":~");
+					stat.open_episode(black.name() + ":" + white.name());
+				}
+
+				episode& game = stat.back();
+				agent& who = game.take_turns(black, white);
+				size_t next = 1;
+				if (args.size() > next && std::isalpha(args[next][0])) {
+					if (who.role()[0] != std::tolower(args[next][0])) { // only the player to move is analyzed
+						std::cout << "? " << "player color mismatch" << std::endl << std::endl;
+						continue;
+					}
+					next++;
+				}
+				double interval = 100;
+				if (args.size() > next && !parse(args[next], interval)) {
+					std::cout << "? " << "syntax error" << std::endl << std::endl;
+					continue;
 				}
-				if (size > board::size_x || size > board::size_y) break;
+				interval = interval > 0 ? interval / 100 : 1;
+				std::cout << "= " << std::endl; // the reports follow until the next command
+				who.analyze(game.state(), interval, [](const std::string& info) { std::cout << info << std::endl; });
+				analyzing = &who;
+				continue;
 
 			} else if (args[0] == "name") { // report the name of the program
 				reply = name;
@@ -178,6 +279,7 @@ int main(int argc, const char* argv[]) {
 				reply = "2";
 			} else if (args[0] == "list_commands") { // print supported commands
 				reply = "play\n" "genmove\n" "clear_board\n" "showboard\n" "boardsize\n"
+				        "time_settings\n" "kgs-time_settings\n" "time_left\n" "analyze\n"
 				        "name\n" "version\n" "protocol_version\n" "list_commands\n" "quit\n";
 			} else {
 				reply = "unknown command";
@@ -185,6 +287,7 @@ int main(int argc, const char* argv[]) {
 
 			std::cout << "= " << reply << std::endl << std::endl;
 		}
+		if (analyzing) analyzing->end_analysis();
 	}
 
 	if (summary) {
@@ -0,0 +1,253 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * playout.h: Define the playout engine used by the simulations of the search
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <cstdint>
+#include <random>
+#include <array>
+#include "board.h"
+
+/**
+ * random playouts with a candidate list of points for each color
+ *
+ * the lists start from the legal moves of the board; since stones are never removed in
+ * NoGo, a point that becomes illegal for a color never becomes legal again, so the lists
+ * are maintained lazily: a sampled candidate is swapped with the last one and dropped,
+ * and it is played if it is still legal, otherwise the next candidate is sampled
+ *
+ * the candidates are sampled uniformly, so the moves are uniform among the legal moves
+ */
+class playout {
+public:
+	/**
+	 * play out the game at b with who to move, record the moves of black and white
+	 * as board bits in bpos and wpos, and return the winner
+	 */
+	template<typename engine>
+	board::piece_type run(board& b, board::piece_type who, engine& rng,
+			board::bitboard& bpos, board::bitboard& wpos) {
+		fill(black, b.legal_moves(board::black));
+		fill(white, b.legal_moves(board::white));
+		for (;; who = opponent(who)) {
+			candidates& c = list[who - 1];
+			const board::bitboard& legal = b.legal_moves(who);
+			unsigned move = none;
+			while (c.size) {
+				unsigned k = std::uniform_int_distribution<unsigned>(0, c.size - 1)(rng);
+				unsigned m = c.at[k];
+				c.at[k] = c.at[--c.size];
+				if (legal.test(m)) {
+					move = m;
+					break;
+				}
+			}
+			if (move == none) return opponent(who);
+			b.play_unchecked(board::at(move), who);
+			(who == board::black ? bpos : wpos).set(move);
+		}
+	}
+
+protected:
+	enum { black = 0, white = 1, none = -1u };
+	static board::piece_type opponent(board::piece_type who) {
+		return who == board::black ? board::white : board::black;
+	}
+
+	struct candidates {
+		uint8_t at[board::bits];
+		unsigned size;
+	};
+	void fill(unsigned k, board::bitboard moves) {
+		candidates& c = list[k];
+		for (c.size = 0; moves; c.size++) c.at[c.size] = moves.pop();
+	}
+
+private:
+	candidates list[2];
+};
+
+/**
+ * playouts that sample the moves by the weights of their 3x3 patterns
+ *
+ * the pattern of a cell is its 8 neighbors, each of which is empty, own, opponent's, or off the
+ * board (the hollow and the guards), encoded in 2 bits from the view of the player to move, and
+ * the weight of a pattern is looked up in a table of 4^8 entries, which is built by build()
+ *
+ * the weights of the legal moves of each color are kept in a sum tree, which samples a move in
+ * O(log n); after a move, only the 8 neighbors of the move and the cells whose legality changed
+ * (the difference of the legal sets) are updated, and the patterns of the neighbors are updated
+ * by setting the field of the move
+ *
+ * since a cell illegal for both colors never becomes legal again in NoGo, only the cells legal
+ * for either color at the start of the playout are tracked
+ */
+class pattern_playout {
+public:
+	/**
+	 * play out the game at b with who to move, record the moves of black and white
+	 * as board bits in bpos and wpos, and return the winner
+	 */
+	template<typename engine>
+	board::piece_type run(board& b, board::piece_type who, engine& rng,
+			board::bitboard& bpos, board::bitboard& wpos) {
+		board::bitboard legal[2] = { b.legal_moves(board::black), b.legal_moves(board::white) };
+		weights[0].clear();
+		weights[1].clear();
+		for (board::bitboard m = legal[0] | legal[1]; m; ) {
+			unsigned i = m.pop(), code = codes[i] = pattern(b, i);
+			if (legal[0].test(i)) weights[0].put(i, table()[code]);
+			if (legal[1].test(i)) weights[1].put(i, table()[swap(code)]);
+		}
+		weights[0].build();
+		weights[1].build();
+		for (;; who = opponent(who)) {
+			sum_tree& w = weights[who - 1];
+			if (!w.total()) return opponent(who);
+			unsigned move = w.find(std::uniform_int_distribution<uint32_t>(0, w.total() - 1)(rng));
+			b.play_unchecked(board::at(move), who);
+			(who == board::black ? bpos : wpos).set(move);
+			// the cells whose legality changed, and the legal cells whose patterns changed
+			// the field of the move in the pattern of its neighbor at ring()[f] is the field 7 - f
+			const board::bitboard& black = b.legal_moves(board::black), & white = b.legal_moves(board::white);
+			board::bitboard dirty = (legal[0] ^ black) | (legal[1] ^ white);
+			for (unsigned f = 0; f < 8; f++) {
+				unsigned n = move + ring()[f];
+				if (n >= board::bits) continue;
+				codes[n] |= (who == board::black ? mine : theirs) << (2 * f);
+				dirty.set(n);
+			}
+			dirty &= legal[0] | legal[1];
+			while (dirty) {
+				unsigned i = dirty.pop(), code = codes[i];
+				weights[0].set(i, black.test(i) ? table()[code] : 0);
+				weights[1].set(i, white.test(i) ? table()[swap(code)] : 0);
+			}
+			legal[0] = black;
+			legal[1] = white;
+		}
+	}
+
+protected:
+	enum cell_type { space = 0, mine = 1, theirs = 2, off = 3 };
+
+	/**
+	 * the pattern around the bit i from the view of black, and the same pattern from the view of white
+	 */
+	static unsigned pattern(const board& b, unsigned i) {
+		const board::bitboard& black = b.stones(board::black), & white = b.stones(board::white);
+		unsigned code = 0;
+		for (int d : ring()) {
+			unsigned n = i + d;
+			unsigned cell = n >= board::bits || !board::playable().test(n) ? off
+				: black.test(n) ? mine : white.test(n) ? theirs : space;
+			code = (code << 2) | cell;
+		}
+		return code;
+	}
+	static unsigned swap(unsigned code) {
+		unsigned flip = (code ^ (code >> 1)) & 0x5555; // the fields of mine or theirs
+		return code ^ (flip * 3);
+	}
+	static board::piece_type opponent(board::piece_type who) {
+		return who == board::black ? board::white : board::black;
+	}
+
+	/**
+	 * the offsets of the 8 neighbors, in the order of the 2-bit fields of a pattern from the highest,
+	 * where the orthogonal neighbors are the fields 1, 3, 4, and 6
+	 */
+	static const std::array<int, 8>& ring() {
+		static const std::array<int, 8> offsets = {{ -int(board::stride) - 1, -int(board::stride), -int(board::stride) + 1,
+			-1, 1, int(board::stride) - 1, int(board::stride), int(board::stride) + 1 }};
+		return offsets;
+	}
+
+	/**
+	 * the weights of the 4^8 patterns, which prefer the moves that make an eye, i.e., an empty
+	 * point whose orthogonal neighbors are all own stones or off the board, where the opponent
+	 * cannot play, and the moves that spoil an eye of the opponent, while filling an own eye,
+	 * which only wastes a move that the opponent can never take, is the last resort
+	 *
+	 * an orthogonal neighbor is taken as an eye in the making if it is empty and both diagonal
+	 * neighbors next to it are own (or the opponent's) stones or off the board
+	 */
+	static const std::array<uint16_t, 1 << 16>& table() {
+		static const std::array<uint16_t, 1 << 16> weights = build();
+		return weights;
+	}
+	static std::array<uint16_t, 1 << 16> build() {
+		// the orthogonal fields, and the diagonal fields next to each of them
+		const unsigned orthogonal[4] = { 1, 3, 4, 6 }, beside[4][2] = { {0, 2}, {0, 5}, {2, 7}, {5, 7} };
+		std::array<uint16_t, 1 << 16> weights;
+		for (unsigned code = 0; code < (1u << 16); code++) {
+			auto field = [code](unsigned f) { return (code >> (14 - 2 * f)) & 3; };
+			unsigned closed = 0, weight = base_weight;
+			for (unsigned k = 0; k < 4; k++) {
+				unsigned n = field(orthogonal[k]), d0 = field(beside[k][0]), d1 = field(beside[k][1]);
+				if (n == mine || n == off) closed++;
+				if (n == theirs) weight += contact_weight;
+				if (n != space) continue;
+				if ((d0 == mine || d0 == off) && (d1 == mine || d1 == off)) weight += eye_weight;
+				if ((d0 == theirs || d0 == off) && (d1 == theirs || d1 == off)) weight += spoil_weight;
+			}
+			weights[code] = closed == 4 ? 1 : weight;
+		}
+		return weights;
+	}
+	enum { base_weight = 8, contact_weight = 2, eye_weight = 10, spoil_weight = 8 };
+
+	/**
+	 * a binary indexed tree of the weights of the board bits, for sampling a bit by its weight
+	 */
+	class sum_tree {
+	public:
+		void clear() { leaf.fill(0); }
+		uint32_t total() const { return sum[size]; }
+		/**
+		 * set the weight of the bit i, or put it before build(), which sums all the weights in O(n)
+		 */
+		void set(unsigned i, uint32_t w) {
+			uint32_t delta = w - leaf[i];
+			if (!delta) return;
+			leaf[i] = w;
+			for (unsigned k = i + 1; k <= size; k += k & -k) sum[k] += delta;
+		}
+		void put(unsigned i, uint32_t w) { leaf[i] = w; }
+		void build() {
+			sum[0] = 0;
+			for (unsigned k = 1; k <= size; k++) sum[k] = leaf[k - 1];
+			for (unsigned k = 1; k <= size; k++) {
+				unsigned parent = k + (k & -k);
+				if (parent <= size) sum[parent] += sum[k];
+			}
+		}
+		/**
+		 * the bit i where the prefix sum of the weights before i is at most x and the one after exceeds x
+		 */
+		unsigned find(uint32_t x) const {
+			unsigned i = 0;
+			for (unsigned step = size / 2; step; step /= 2) {
+				if (sum[i + step] <= x) {
+					i += step;
+					x -= sum[i];
+				}
+			}
+			return i;
+		}
+	private:
+		// a power of two for the descent of find()
+		enum { size = board::bits <= 64 ? 64 : board::bits <= 128 ? 128 : 256 };
+		std::array<uint32_t, size + 1> sum;
+		std::array<uint32_t, size> leaf;
+	};
+
+private:
+	sum_tree weights[2];
+	std::array<uint16_t, board::bits> codes; // the patterns from the view of black
+};
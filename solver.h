@@ -0,0 +1,128 @@
+/**
+ * Framework for NoGo and similar games (C++ 11)
+ * solver.h: Define the exact solver of the endgames
+ *
+ * Author: Theory of Computer Games (TCG 2021)
+ *         Computer Games and Intelligence (CGI) Lab, NYCU, Taiwan
+ *         https://cgilab.nctu.edu.tw/
+ */
+
+#pragma once
+#include <cstdint>
+#include <chrono>
+#include <memory>
+#include <array>
+#include <algorithm>
+#include "board.h"
+
+/**
+ * depth-first proof search of the endgames: the player to move wins if any move leads to a
+ * position that the opponent loses, and loses if there is no legal move or all moves fail
+ *
+ * the proven positions are kept in a hash table by their hash (see board::hash), which stays
+ * valid across the searches and the games since the results are exact; the moves are tried
+ * in the order of the killer of their depth, i.e., the last winning move found at that depth,
+ * then the descending mobility gain (see board::mobility)
+ *
+ * the search is given a deadline, and the result is unknown if the deadline passes first
+ */
+class solver {
+public:
+	typedef std::chrono::high_resolution_clock clock;
+	enum result { loss = -1, unknown = 0, win = 1 };
+
+	/**
+	 * a solver with a hash table of (1 << bits) entries, which is allocated by the first search
+	 */
+	explicit solver(unsigned bits = 20) : bits(bits), count(0), elapsed(0) {}
+
+	/**
+	 * solve the position b with who to move before the deadline, and set move (a board bit)
+	 * to the winning move if who wins
+	 */
+	result solve(const board& b, board::piece_type who, clock::time_point deadline, unsigned& move) {
+		if (!table) table.reset(new entry[1ull << bits]());
+		const clock::time_point start = clock::now();
+		this->deadline = deadline;
+		aborted = false;
+		count = 0;
+		killers.fill(none);
+		bool won = wins(b, who, 0, move);
+		elapsed = std::chrono::duration<double>(clock::now() - start).count();
+		return aborted ? unknown : won ? win : loss;
+	}
+
+	/**
+	 * the nodes visited by the last search and its time in seconds
+	 */
+	uint64_t nodes() const { return count; }
+	double seconds() const { return elapsed; }
+
+protected:
+	/**
+	 * whether who to move at b wins, and the winning move if so
+	 */
+	bool wins(const board& b, board::piece_type who, unsigned depth, unsigned& move) {
+		if ((++count % check_interval) == 0 && clock::now() >= deadline) aborted = true;
+		if (aborted) return false;
+		board::bitboard moves = b.legal_moves(who);
+		if (!moves) return false;
+
+		const uint64_t key = b.hash() | 1; // the key 0 is reserved for empty entries
+		entry* e = table.get() + (key & ((1ull << bits) - 2));
+		for (entry* k = e; k != e + 2; k++) {
+			if (k->key != key) continue;
+			move = k->move;
+			return k->won;
+		}
+
+		const uint64_t before = count;
+		const board::piece_type opp = who == board::black ? board::white : board::black;
+		std::array<std::pair<int, unsigned>, board::bits> order;
+		unsigned n = 0;
+		while (moves) {
+			unsigned m = moves.pop();
+			order[n++] = std::make_pair(m == killer(depth) ? -int(board::bits) - 1 : -b.mobility(m, who), m);
+		}
+		std::sort(order.begin(), order.begin() + n);
+
+		bool won = false;
+		move = none;
+		for (unsigned k = 0; k < n && !won; k++) {
+			board after = b;
+			after.play_unchecked(board::at(order[k].second), who);
+			unsigned reply;
+			won = !wins(after, opp, depth + 1, reply);
+			if (aborted) return false;
+			if (won) move = order[k].second;
+		}
+		if (won && depth < killers.size()) killers[depth] = move;
+
+		// replace the entry of fewer nodes searched
+		const unsigned work = 64 - __builtin_clzll(count - before);
+		if (e[1].work < e[0].work) e++;
+		e->key = key;
+		e->move = won ? move : 0;
+		e->won = won;
+		e->work = work;
+		return won;
+	}
+
+	unsigned killer(unsigned depth) const { return depth < killers.size() ? killers[depth] : unsigned(none); }
+
+private:
+	enum : unsigned { none = -1u, check_interval = 4096 };
+	struct entry {
+		uint64_t key;
+		uint8_t move;
+		bool won;
+		uint8_t work; // the log2 of the nodes searched for the entry
+	};
+	std::unique_ptr<entry[]> table;
+	unsigned bits;
+	std::array<unsigned, board::bits> killers;
+	clock::time_point deadline;
+	bool aborted;
+	uint64_t count;
+	double elapsed;
+};